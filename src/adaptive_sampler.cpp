@@ -0,0 +1,173 @@
+#include "adaptive_sampler.h"
+#include "quadrature.h"
+#include <algorithm>
+#include <cmath>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+
+    // Panels of the first uniform pass, 4 * kInitialPanels + 1 evaluations
+    const int kInitialPanels = 8;
+
+    // One panel's five samples, the least any grid can hold
+    const int kMinEvaluations = 5;
+} // namespace
+
+template <typename T>
+void AdaptiveSampler<T>::Reset(T range_start, T range_end) {
+    panels_.clear();
+    range_start_ = range_start;
+    range_end_ = range_end;
+    report_ = {0, 0, 0.0, false};
+}
+
+template <typename T>
+AdaptiveReport AdaptiveSampler<T>::Refine(const Function& target_func, T tolerance, int max_evaluations) {
+    // Any first pass costs at least one panel, a smaller budget could not be kept
+    max_evaluations = std::max(max_evaluations, kMinEvaluations);
+
+    auto f = [&target_func](A x) { return static_cast<A>(target_func(static_cast<T>(x))); };
+
+    if (panels_.empty()) {
+        // Start coarser when the budget cannot afford the default first pass
+        int initial = std::min(kInitialPanels, std::max((max_evaluations - 1) / 4, 1));
+        const A width = (static_cast<A>(range_end_) - range_start_) / initial;
+
+        A left = range_start_;
+        A f_left = f(left);
+        for (int k = 0; k < initial; ++k) {
+            A right = (k == initial - 1) ? static_cast<A>(range_end_) : range_start_ + (k + 1) * width;
+            A f_right = f(right);
+            panels_.push_back(MakePanel(target_func, left, right, f_left, f((left + right) / 2), f_right));
+            left = right;
+            f_left = f_right;
+        }
+        report_.evaluations = 4 * initial + 1;
+    }
+
+    auto by_error = [](const Panel& lhs, const Panel& rhs) { return lhs.error < rhs.error; };
+    std::make_heap(panels_.begin(), panels_.end(), by_error);
+
+    A total_error = 0;
+    for (const Panel& panel : panels_) {
+        total_error += panel.error;
+    }
+
+    // Each split keeps 5 samples and adds the quarter points of both halves
+    while (total_error > tolerance && report_.evaluations + 4 <= max_evaluations) {
+        std::pop_heap(panels_.begin(), panels_.end(), by_error);
+        Panel worst = panels_.back();
+        panels_.pop_back();
+
+        const A middle = (worst.a + worst.b) / 2;
+        Panel left = MakePanel(target_func, worst.a, middle, worst.fa, worst.fq1, worst.fm);
+        Panel right = MakePanel(target_func, middle, worst.b, worst.fm, worst.fq2, worst.fb);
+        report_.evaluations += 4;
+
+        total_error += left.error + right.error - worst.error;
+
+        panels_.push_back(left);
+        std::push_heap(panels_.begin(), panels_.end(), by_error);
+        panels_.push_back(right);
+        std::push_heap(panels_.begin(), panels_.end(), by_error);
+    }
+
+    // Coefficient sums run left to right
+    std::sort(panels_.begin(), panels_.end(), [](const Panel& lhs, const Panel& rhs) { return lhs.a < rhs.a; });
+
+    UpdateReport(tolerance);
+    return report_;
+}
+
+template <typename T>
+double AdaptiveSampler<T>::SignalEnergy() const {
+    const A width = static_cast<A>(range_end_) - range_start_;
+    if (panels_.empty() || !(width != A(0))) {
+        return 0.0;
+    }
+
+    A sum = 0;
+    for (const Panel& panel : panels_) {
+        sum += (panel.b - panel.a) / 12 * (panel.fa * panel.fa + 4 * panel.fq1 * panel.fq1 + 2 * panel.fm * panel.fm + 
+                                           4 * panel.fq2 * panel.fq2 + panel.fb * panel.fb);
+    }
+    return static_cast<double>(sum / width);
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> AdaptiveSampler<T>::Coefficients(const std::vector<int>& indices) const {
+    const A L = (static_cast<A>(range_end_) - range_start_) / 2;
+
+    std::vector<HarmonicCoefficient<T>> coefficients;
+    coefficients.reserve(indices.size());
+
+    for (int n : indices) {
+        const A w = n * static_cast<A>(kPiLong) / L;
+
+        std::complex<A> sum = 0;
+        for (const Panel& panel : panels_) {
+            const A middle = (panel.a + panel.b) / 2;
+            const A left_x[3] = {panel.a, (panel.a + middle) / 2, middle};
+            const A left_f[3] = {panel.fa, panel.fq1, panel.fm};
+            const A right_x[3] = {middle, (middle + panel.b) / 2, panel.b};
+            const A right_f[3] = {panel.fm, panel.fq2, panel.fb};
+
+            sum += QuadraticOscillatoryIntegral(left_x, left_f, panel.a, middle, w);
+            sum += QuadraticOscillatoryIntegral(right_x, right_f, middle, panel.b, w);
+        }
+
+        coefficients.push_back({n, static_cast<T>(sum.real() / L), static_cast<T>(sum.imag() / L)});
+    }
+
+    return coefficients;
+}
+
+template <typename T>
+typename AdaptiveSampler<T>::Panel AdaptiveSampler<T>::MakePanel(const Function& target_func, A a, A b, A fa, A fm, A fb) {
+    Panel panel;
+    panel.a = a;
+    panel.b = b;
+    panel.fa = fa;
+    panel.fm = fm;
+    panel.fb = fb;
+    panel.fq1 = static_cast<A>(target_func(static_cast<T>((3 * a + b) / 4)));
+    panel.fq2 = static_cast<A>(target_func(static_cast<T>((a + 3 * b) / 4)));
+    panel.error = PanelError(panel);
+    return panel;
+}
+
+template <typename T>
+typename AdaptiveSampler<T>::A AdaptiveSampler<T>::PanelError(const Panel& panel) const {
+    // Quarter points against the quadratic through the ends and middle,
+    // q(quarter) = (3 fa + 6 fm - fb) / 8. A jump inside the panel also shows here.
+    const A predicted_q1 = (3 * panel.fa + 6 * panel.fm - panel.fb) / 8;
+    const A predicted_q2 = (3 * panel.fb + 6 * panel.fm - panel.fa) / 8;
+    const A deviation = std::max(std::abs(panel.fq1 - predicted_q1), std::abs(panel.fq2 - predicted_q2));
+
+    // |a_n error| <= (1/L) int |f - q|, bounded by width * deviation / L
+    const A L = (static_cast<A>(range_end_) - range_start_) / 2;
+    A error = (panel.b - panel.a) * deviation / L;
+
+    // NaN from a pole must rank as the worst panel, not silently compare false
+    return std::isfinite(error) ? error : A(1e30);
+}
+
+template <typename T>
+void AdaptiveSampler<T>::UpdateReport(T tolerance) {
+    A total_error = 0;
+    for (const Panel& panel : panels_) {
+        total_error += panel.error;
+    }
+
+    report_.panels = static_cast<int>(panels_.size());
+    report_.error_estimate = static_cast<double>(total_error);
+    report_.converged = total_error <= tolerance;
+}
+
+template class AdaptiveSampler<float>;
+template class AdaptiveSampler<double>;
+template class AdaptiveSampler<long double>;
+
+} // namespace fourier_sim
@@ -0,0 +1,69 @@
+#ifndef ADAPTIVE_SAMPLER_H_
+#define ADAPTIVE_SAMPLER_H_
+
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+struct AdaptiveReport {
+    int evaluations;
+    int panels;
+    double error_estimate;  // Bound on |a_n|, |b_n| error shared by every n
+    bool converged;
+};
+
+// Globally adaptive grid for the coefficient integrals. Each panel holds five
+// samples (ends, quarters, middle); the worst panel is split in two, which keeps
+// its samples and costs two new evaluations per child. Coefficients integrate
+// the half-panel quadratics exactly against the oscillation, so the grid does
+// not need to be uniform. Instantiated for float, double and long double.
+template <typename T>
+class AdaptiveSampler {
+
+    public:
+        using Function = std::function<T(T)>;
+
+        // Drops all panels, the next Refine() starts from a coarse uniform grid
+        void Reset(T range_start, T range_end);
+
+        // Splits panels until the summed error estimate is below tolerance or
+        // max_evaluations would be exceeded. Continues from the current grid, so
+        // a larger budget only pays for the new samples. Budgets below 5 are raised to 5,
+        // the samples of a single panel.
+        AdaptiveReport Refine(const Function& target_func, T tolerance, int max_evaluations);
+
+        std::vector<HarmonicCoefficient<T>> Coefficients(const std::vector<int>& indices) const;
+
+        // Mean of f^2 over the range, Simpson on both halves of every panel
+        double SignalEnergy() const;
+
+        const AdaptiveReport& GetReport() const { return report_; }
+        T GetRangeStart() const { return range_start_; }
+        T GetRangeEnd() const { return range_end_; }
+
+    private:
+        using A = std::common_type_t<T, double>;
+
+        struct Panel {
+            A a, b;
+            A fa, fq1, fm, fq2, fb;
+            A error;
+        };
+
+        Panel MakePanel(const Function& target_func, A a, A b, A fa, A fm, A fb);
+        A PanelError(const Panel& panel) const;
+        void UpdateReport(T tolerance);
+
+        std::vector<Panel> panels_;
+        T range_start_ = T(0);
+        T range_end_ = T(0);
+        AdaptiveReport report_ = {0, 0, 0.0, false};
+
+};
+
+} // namespace fourier_sim
+
+#endif  // ADAPTIVE_SAMPLER_H_
@@ -0,0 +1,172 @@
+#include "coefficient_batch.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+
+    // Micro-tile of kRows functions x kLanes basis columns held in registers
+    // across the whole sample block
+    constexpr int kRows = 4;
+    constexpr int kLanes = 8;
+
+    // A 128 x 256 basis panel of double is 256 KiB and stays in L2 while every
+    // function block streams past it
+    constexpr int kColumnBlock = 256;
+    constexpr int kSampleBlock = 128;
+} // namespace
+
+template <typename T>
+CoefficientBatch<T>::CoefficientBatch(QuadratureRule rule, int slices, T range_start, T range_end, std::vector<int> indices)
+    : rule_(rule), range_start_(range_start), range_end_(range_end), indices_(std::move(indices)) {
+    sample_count_ = QuadratureSampleCount(rule_, slices);
+    BuildBasis();
+}
+
+template <typename T>
+void CoefficientBatch<T>::BuildBasis() {
+    using A = std::common_type_t<T, double>;
+
+    const int harmonic_count = static_cast<int>(indices_.size());
+    columns_ = (2 * harmonic_count + kLanes - 1) / kLanes * kLanes;
+    basis_.assign(static_cast<size_t>(sample_count_) * columns_, T(0));
+    if (sample_count_ == 0) {
+        return;
+    }
+
+    const bool closed = rule_ != QuadratureRule::kRiemann;
+    const int panels = closed ? sample_count_ - 1 : sample_count_;
+    const A kPi = static_cast<A>(kPiLong);
+    const A L = (static_cast<A>(range_end_) - range_start_) / 2;
+    const A h = 2 * L / panels;
+    const A scale = h / L;
+
+    for (int k = 0; k < harmonic_count; ++k) {
+        const int n = indices_[k];
+        const A w = n * kPi / L;
+
+        // Phase at sample i is w x_0 + 2 pi (n i mod panels) / panels, the endpoint
+        // sample shares the phase of the first
+        const A phase0 = w * range_start_;
+        const int step = ((n % panels) + panels) % panels;
+
+        A alpha = A(0), beta = A(1), gamma = A(1);
+        if (rule_ == QuadratureRule::kFilon || rule_ == QuadratureRule::kPiecewise) {
+            FilonWeights(w * h, alpha, beta, gamma);
+        }
+
+        long long turn = 0;
+        for (int i = 0; i < sample_count_; ++i) {
+            const A angle = phase0 + 2 * kPi * static_cast<A>(turn) / panels;
+            turn = (turn + step) % panels;
+
+            A weight = A(1);
+            if (rule_ == QuadratureRule::kSimpson) {
+                weight = (i == 0 || i == panels) ? A(1) / 3 : (i % 2 ? A(4) / 3 : A(2) / 3);
+            } else if (closed) {
+                weight = (i % 2) ? gamma : ((i == 0 || i == panels) ? beta / 2 : beta);
+            }
+
+            T* row = basis_.data() + static_cast<size_t>(i) * columns_;
+            row[2 * k] = static_cast<T>(scale * weight * std::cos(angle));
+            row[2 * k + 1] = static_cast<T>(scale * weight * std::sin(angle));
+        }
+
+        // Filon's boundary term h alpha (f_N - f_0) lives on the two end samples
+        if (alpha != A(0)) {
+            const A boundary_a = scale * alpha * std::sin(phase0);
+            const A boundary_b = -scale * alpha * std::cos(phase0);
+            T* first = basis_.data();
+            T* last = basis_.data() + static_cast<size_t>(panels) * columns_;
+            first[2 * k] -= static_cast<T>(boundary_a);
+            first[2 * k + 1] -= static_cast<T>(boundary_b);
+            last[2 * k] += static_cast<T>(boundary_a);
+            last[2 * k + 1] += static_cast<T>(boundary_b);
+        }
+    }
+}
+
+template <typename T>
+bool CoefficientBatch<T>::AddSamples(const std::vector<T>& samples) {
+    if (static_cast<int>(samples.size()) != sample_count_) {
+        return false;
+    }
+    samples_.insert(samples_.end(), samples.begin(), samples.end());
+    ++function_count_;
+    return true;
+}
+
+template <typename T>
+void CoefficientBatch<T>::Clear() {
+    samples_.clear();
+    function_count_ = 0;
+}
+
+template <typename T>
+std::vector<std::vector<HarmonicCoefficient<T>>> CoefficientBatch<T>::Compute() const {
+    const int N = sample_count_;
+    const int C = columns_;
+    std::vector<T> product(static_cast<size_t>(function_count_) * C, T(0));
+
+    for (int c0 = 0; c0 < C; c0 += kColumnBlock) {
+        const int c1 = std::min(c0 + kColumnBlock, C);
+
+        for (int i0 = 0; i0 < N; i0 += kSampleBlock) {
+            const int i1 = std::min(i0 + kSampleBlock, N);
+
+            for (int f0 = 0; f0 < function_count_; f0 += kRows) {
+                const int rows = std::min(kRows, function_count_ - f0);
+
+                // A short last block repeats its final row and drops the extra results
+                const T* f_rows[kRows];
+                for (int r = 0; r < kRows; ++r) {
+                    f_rows[r] = samples_.data() + static_cast<size_t>(f0 + std::min(r, rows - 1)) * N;
+                }
+
+                for (int c = c0; c < c1; c += kLanes) {
+                    T acc[kRows][kLanes] = {};
+                    for (int i = i0; i < i1; ++i) {
+                        const T* b = basis_.data() + static_cast<size_t>(i) * C + c;
+                        for (int r = 0; r < kRows; ++r) {
+                            const T v = f_rows[r][i];
+                            for (int l = 0; l < kLanes; ++l) {
+                                acc[r][l] += v * b[l];
+                            }
+                        }
+                    }
+
+                    for (int r = 0; r < rows; ++r) {
+                        T* out = product.data() + static_cast<size_t>(f0 + r) * C + c;
+                        for (int l = 0; l < kLanes; ++l) {
+                            out[l] += acc[r][l];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<std::vector<HarmonicCoefficient<T>>> coefficients(function_count_);
+    for (int f = 0; f < function_count_; ++f) {
+        const T* row = product.data() + static_cast<size_t>(f) * C;
+        coefficients[f].resize(indices_.size());
+        for (size_t k = 0; k < indices_.size(); ++k) {
+            coefficients[f][k] = {indices_[k], row[2 * k], row[2 * k + 1]};
+        }
+    }
+    return coefficients;
+}
+
+template <typename T>
+size_t CoefficientBatch<T>::MemoryBytes() const {
+    return (basis_.capacity() + samples_.capacity()) * sizeof(T) + indices_.capacity() * sizeof(int);
+}
+
+template class CoefficientBatch<float>;
+template class CoefficientBatch<double>;
+template class CoefficientBatch<long double>;
+
+} // namespace fourier_sim
@@ -0,0 +1,74 @@
+#ifndef COEFFICIENT_BATCH_H_
+#define COEFFICIENT_BATCH_H_
+
+#include <vector>
+#include "coefficient_engine.h"
+#include "quadrature.h"
+
+namespace fourier_sim {
+
+// Coefficients for many functions sampled on one grid. Every linear rule is a fixed
+// matrix B with a row per a_n and b_n, so the batch is C = F B^T with F holding one
+// sampled function per row. B is built once (the only trig in the batch) and reused
+// by every Compute; the product runs as a blocked GEMM.
+//
+// kPiecewise splits at breakpoints found per function, which is not linear, so here
+// it is plain Filon as in IntegrateCoefficients.
+// Instantiated for float, double and long double in coefficient_batch.cpp.
+template <typename T>
+class CoefficientBatch {
+
+    public:
+        CoefficientBatch(QuadratureRule rule, int slices, T range_start, T range_end, std::vector<int> indices);
+
+        // Samples per function, at range_start + i * T / panels as the generator lays them out
+        int GetSampleCount() const { return sample_count_; }
+        int GetFunctionCount() const { return function_count_; }
+        const std::vector<int>& GetIndices() const { return indices_; }
+
+        template <typename F>
+        void AddFunction(const F& target_func) {
+            const int panels = (rule_ == QuadratureRule::kRiemann) ? sample_count_ : sample_count_ - 1;
+            const T kDeltaX = (range_end_ - range_start_) / static_cast<T>(panels);
+
+            samples_.resize(samples_.size() + sample_count_);
+            T* row = samples_.data() + samples_.size() - sample_count_;
+            for (int i = 0; i < sample_count_; ++i) {
+                row[i] = target_func(range_start_ + i * kDeltaX);
+            }
+            ++function_count_;
+        }
+
+        // Appends already sampled values, ignored unless there are GetSampleCount() of them
+        bool AddSamples(const std::vector<T>& samples);
+
+        // Drops the functions, keeps the basis for the next batch
+        void Clear();
+
+        // One coefficient list per added function, in the order they were added
+        std::vector<std::vector<HarmonicCoefficient<T>>> Compute() const;
+
+        size_t MemoryBytes() const;
+
+    private:
+        void BuildBasis();
+
+        QuadratureRule rule_;
+        T range_start_;
+        T range_end_;
+        std::vector<int> indices_;
+        int sample_count_ = 0;
+
+        // Sample-major B^T: row i holds the weight of sample i for a_0, b_0, a_1, ...,
+        // padded with zero columns to a multiple of the kernel width
+        std::vector<T> basis_;
+        int columns_ = 0;
+
+        std::vector<T> samples_;
+        int function_count_ = 0;
+
+};
+
+} // namespace fourier_sim
+
+#endif  // COEFFICIENT_BATCH_H_
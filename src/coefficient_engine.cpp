@@ -0,0 +1,250 @@
+#include "coefficient_engine.h"
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <type_traits>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+
+    // Float jobs still run recurrences and rotations in double
+    template <typename T>
+    using Accum = std::common_type_t<T, double>;
+
+    // Rotates sum_i f_i e^{-j 2 pi n i / N} onto the grid phase n*pi*x_i/L and scales to a_n, b_n
+    template <typename T, typename A>
+    HarmonicCoefficient<T> FromBin(int n, std::complex<A> bin, int N, A range_start, A T_period) {
+        const A psi = A(2) * static_cast<A>(kPiLong) * n * range_start / T_period;
+        const A sum_cos = std::cos(psi) * bin.real() + std::sin(psi) * bin.imag();
+        const A sum_sin = std::sin(psi) * bin.real() - std::cos(psi) * bin.imag();
+
+        const A scale = A(2) / N;
+        return {n, static_cast<T>(sum_cos * scale), static_cast<T>(sum_sin * scale)};
+    }
+
+    // Phase of harmonic n at range_start, reduced to [0, 2 pi) in at least double
+    template <typename T>
+    Accum<T> StartPhase(int n, T range_start, T range_end) {
+        using A = Accum<T>;
+        const A turns = n * (static_cast<A>(range_start) / (static_cast<A>(range_end) - range_start));
+        return A(2) * static_cast<A>(kPiLong) * (turns - std::floor(turns));
+    }
+
+    // f_i cos and f_i sin of n pi x_i / L times the step, rounded to T. The phase comes from
+    // the exact index product (n i) mod N in at least double: rounded in T it would be off by
+    // far more than any summation error at high n.
+    template <typename T>
+    void DirectTerms(T f_x, int n, int i, int slices, Accum<T> start_phase, T delta_x, T& term_a, T& term_b) {
+        using A = Accum<T>;
+        const long long turn_index = (static_cast<long long>(n) * i) % slices;
+        const A angle = start_phase + A(2) * static_cast<A>(kPiLong) * static_cast<A>(turn_index) / slices;
+        term_a = f_x * static_cast<T>(std::cos(angle)) * delta_x;
+        term_b = f_x * static_cast<T>(std::sin(angle)) * delta_x;
+    }
+} // namespace
+
+const char* EngineName(EngineKind kind) {
+    switch (kind) {
+        case EngineKind::kAuto: return "auto";
+        case EngineKind::kDirect: return "direct";
+        case EngineKind::kFft: return "fft";
+        case EngineKind::kGoertzel: return "goertzel";
+    }
+    return "unknown";
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> DirectCoefficients(const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices, SummationMode summation) {
+    const int slices = static_cast<int>(samples.size());
+    const T T_period = range_end - range_start;
+    const T L = T_period / T(2);
+
+    const T kDeltaX = T_period / static_cast<T>(slices);
+
+    std::vector<HarmonicCoefficient<T>> coefficients;
+    coefficients.reserve(indices.size());
+
+    // Pairwise mode needs the terms materialized, reused across indices
+    std::vector<T> terms_a;
+    std::vector<T> terms_b;
+    if (summation == SummationMode::kPairwise) {
+        terms_a.resize(slices);
+        terms_b.resize(slices);
+    }
+
+    for (int n : indices){
+        T sum_a = T(0);
+        T sum_b = T(0);
+
+        NeumaierSum<T> compensated_a;
+        NeumaierSum<T> compensated_b;
+
+        const Accum<T> start_phase = StartPhase(n, range_start, range_end);
+        for (int i = 0; i < slices; ++i){
+            T term_a;
+            T term_b;
+            DirectTerms(samples[i], n, i, slices, start_phase, kDeltaX, term_a, term_b);
+
+            switch (summation) {
+                case SummationMode::kNaive:
+                    sum_a += term_a;
+                    sum_b += term_b;
+                    break;
+                case SummationMode::kNeumaier:
+                    compensated_a.Add(term_a);
+                    compensated_b.Add(term_b);
+                    break;
+                case SummationMode::kPairwise:
+                    terms_a[i] = term_a;
+                    terms_b[i] = term_b;
+                    break;
+            }
+        }
+
+        if (summation == SummationMode::kNeumaier) {
+            sum_a = compensated_a.Result();
+            sum_b = compensated_b.Result();
+        } else if (summation == SummationMode::kPairwise) {
+            sum_a = PairwiseSum(terms_a.data(), terms_a.size());
+            sum_b = PairwiseSum(terms_b.data(), terms_b.size());
+        }
+
+        coefficients.push_back({n, sum_a / L, sum_b / L});
+    }
+
+    return coefficients;
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> FftCoefficients(const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices) {
+    const int N = static_cast<int>(samples.size());
+    std::vector<HarmonicCoefficient<T>> coefficients;
+    coefficients.reserve(indices.size());
+
+    if (N == 0) {
+        for (int n : indices) {
+            coefficients.push_back({n, T(0), T(0)});
+        }
+        return coefficients;
+    }
+
+    std::vector<std::complex<double>> input(samples.begin(), samples.end());
+    std::vector<std::complex<double>> bins(N);
+    DefaultPlanCache().Acquire(N, FftKind::kForward)->Execute(input.data(), bins.data());
+
+    const double T_period = static_cast<double>(range_end) - range_start;
+    for (int n : indices) {
+        // Harmonics past N alias onto bin n mod N, exactly as the sampled sum does; a negative
+        // n wraps to a bin in [0, N) and gets the same a_n, b_n the direct kernel returns
+        const int bin = ((n % N) + N) % N;
+        coefficients.push_back(FromBin<T>(n, bins[bin], N, static_cast<double>(range_start), T_period));
+    }
+
+    return coefficients;
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> GoertzelCoefficients(const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices) {
+    using A = Accum<T>;
+
+    const int N = static_cast<int>(samples.size());
+    const A T_period = static_cast<A>(range_end) - range_start;
+
+    std::vector<HarmonicCoefficient<T>> coefficients;
+    coefficients.reserve(indices.size());
+
+    for (int n : indices) {
+        if (N == 0) {
+            coefficients.push_back({n, T(0), T(0)});
+            continue;
+        }
+
+        // Second-order resonator at w = 2*pi*n/N, at least double to keep the recurrence stable
+        const A w = A(2) * static_cast<A>(kPiLong) * n / N;
+        const A cos_w = std::cos(w);
+        const A coeff = A(2) * cos_w;
+
+        A s1 = A(0);
+        A s2 = A(0);
+        for (int i = 0; i < N; ++i) {
+            A s0 = samples[i] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+
+        // s1 - e^{-jw} s2 = sum f_i e^{jw(N-1-i)}; undo the e^{jw(N-1)} to get the DFT bin
+        const std::complex<A> z(s1 - cos_w * s2, std::sin(w) * s2);
+        const std::complex<A> bin = z * std::polar(A(1), -w * (N - 1));
+
+        coefficients.push_back(FromBin<T>(n, bin, N, static_cast<A>(range_start), T_period));
+    }
+
+    return coefficients;
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> ComputeCoefficients(EngineKind kind, const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices, SummationMode summation) {
+    switch (kind) {
+        case EngineKind::kFft: return FftCoefficients(samples, range_start, range_end, indices);
+        case EngineKind::kGoertzel: return GoertzelCoefficients(samples, range_start, range_end, indices);
+        default: return DirectCoefficients(samples, range_start, range_end, indices, summation);
+    }
+}
+
+template <typename T>
+SummationReport MeasureSummationError(SummationMode mode, const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices) {
+    SummationReport report = {mode, 0.0, 0.0};
+
+    const int N = static_cast<int>(samples.size());
+    if (N == 0 || indices.empty()) {
+        return report;
+    }
+
+    std::vector<HarmonicCoefficient<T>> measured = DirectCoefficients(samples, range_start, range_end, indices, mode);
+
+    // The kernel's own terms summed in long double, so only the summation error is left
+    const T kDeltaX = (range_end - range_start) / static_cast<T>(N);
+    const long double L = (static_cast<long double>(range_end) - range_start) / 2.0L;
+
+    double sum_squares = 0.0;
+    for (size_t k = 0; k < indices.size(); ++k) {
+        const int n = indices[k];
+        const Accum<T> start_phase = StartPhase(n, range_start, range_end);
+
+        NeumaierSum<long double> sum_a;
+        NeumaierSum<long double> sum_b;
+        for (int i = 0; i < N; ++i) {
+            T term_a;
+            T term_b;
+            DirectTerms(samples[i], n, i, N, start_phase, kDeltaX, term_a, term_b);
+            sum_a.Add(term_a);
+            sum_b.Add(term_b);
+        }
+
+        double error_a = static_cast<double>(std::abs(measured[k].a - sum_a.Result() / L));
+        double error_b = static_cast<double>(std::abs(measured[k].b - sum_b.Result() / L));
+        report.max_error = std::max(report.max_error, std::max(error_a, error_b));
+        sum_squares += error_a * error_a + error_b * error_b;
+    }
+
+    report.rms_error = std::sqrt(sum_squares / (2.0 * indices.size()));
+    return report;
+}
+
+#define FOURIER_SIM_INSTANTIATE_ENGINES(T) \
+    template std::vector<HarmonicCoefficient<T>> DirectCoefficients<T>(const std::vector<T>&, T, T, const std::vector<int>&, SummationMode); \
+    template std::vector<HarmonicCoefficient<T>> FftCoefficients<T>(const std::vector<T>&, T, T, const std::vector<int>&); \
+    template std::vector<HarmonicCoefficient<T>> GoertzelCoefficients<T>(const std::vector<T>&, T, T, const std::vector<int>&); \
+    template std::vector<HarmonicCoefficient<T>> ComputeCoefficients<T>(EngineKind, const std::vector<T>&, T, T, const std::vector<int>&, SummationMode); \
+    template SummationReport MeasureSummationError<T>(SummationMode, const std::vector<T>&, T, T, const std::vector<int>&);
+
+FOURIER_SIM_INSTANTIATE_ENGINES(float)
+FOURIER_SIM_INSTANTIATE_ENGINES(double)
+FOURIER_SIM_INSTANTIATE_ENGINES(long double)
+
+#undef FOURIER_SIM_INSTANTIATE_ENGINES
+
+} // namespace fourier_sim
@@ -0,0 +1,60 @@
+#ifndef COEFFICIENT_ENGINE_H_
+#define COEFFICIENT_ENGINE_H_
+
+#include <vector>
+#include "summation.h"
+
+namespace fourier_sim {
+
+template <typename T>
+struct HarmonicCoefficient {
+    int index;
+    T a;
+    T b;
+};
+
+enum class EngineKind {
+    kAuto,
+    kDirect,
+    kFft,
+    kGoertzel
+};
+
+const char* EngineName(EngineKind kind);
+
+// All engines take samples f(range_start + i * T / N), i < N, and return a_n, b_n
+// for each requested index with the same left-Riemann weights.
+// Instantiated for float, double and long double in coefficient_engine.cpp.
+
+// Reference loop with per-sample trig, O(N) trig calls per index.
+// The accumulators use the requested summation mode.
+template <typename T>
+std::vector<HarmonicCoefficient<T>> DirectCoefficients(const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices, SummationMode summation = SummationMode::kNaive);
+
+// One full FFT of the samples, then O(1) per index. The transform itself runs
+// in double, long double jobs that need the extra bits should pin another engine.
+template <typename T>
+std::vector<HarmonicCoefficient<T>> FftCoefficients(const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices);
+
+// Goertzel resonator per index, O(N) multiply-adds and no trig in the inner loop
+template <typename T>
+std::vector<HarmonicCoefficient<T>> GoertzelCoefficients(const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices);
+
+// FFT and Goertzel accumulate in at least double, only the direct kernel uses summation
+template <typename T>
+std::vector<HarmonicCoefficient<T>> ComputeCoefficients(EngineKind kind, const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices, SummationMode summation = SummationMode::kNaive);
+
+struct SummationReport {
+    SummationMode mode;
+    double max_error;
+    double rms_error;
+};
+
+// Error of the direct kernel in the given mode against a long double sum of the
+// same rounded terms, over the requested indices: the summation error alone
+template <typename T>
+SummationReport MeasureSummationError(SummationMode mode, const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices);
+
+} // namespace fourier_sim
+
+#endif  // COEFFICIENT_ENGINE_H_
@@ -0,0 +1,109 @@
+#include "convergence.h"
+#include <algorithm>
+
+namespace fourier_sim {
+
+namespace {
+    // Captured energy above the signal energy by more than this fraction is not rounding
+    const double kEnergySlack = 1e-6;
+} // namespace
+
+template <typename T>
+double SignalEnergy(QuadratureRule rule, const std::vector<T>& samples) {
+    const size_t count = samples.size();
+    if (count == 0) {
+        return 0.0;
+    }
+
+    NeumaierSum<double> sum;
+    if (rule == QuadratureRule::kRiemann || count < 3) {
+        for (const T sample : samples) {
+            const double f = static_cast<double>(sample);
+            sum.Add(f * f);
+        }
+        return sum.Result() / static_cast<double>(count);
+    }
+
+    // Weights 1, 4, 2, ..., 2, 4, 1 over an even panel count, times h / 3 over the range
+    const size_t panels = count - 1;
+    for (size_t i = 0; i < count; ++i) {
+        const double f = static_cast<double>(samples[i]);
+        const double weight = (i == 0 || i == panels) ? 1.0 : ((i % 2 == 1) ? 4.0 : 2.0);
+        sum.Add(weight * f * f);
+    }
+    return sum.Result() / (3.0 * static_cast<double>(panels));
+}
+
+template <typename T>
+void ParsevalTracker<T>::Reset(double signal_energy, int periodic_samples) {
+    signal_energy_ = signal_energy;
+    periodic_samples_ = periodic_samples;
+    Clear();
+}
+
+template <typename T>
+void ParsevalTracker<T>::Clear() {
+    captured_ = NeumaierSum<double>();
+    count_ = 0;
+    aliased_ = 0;
+}
+
+template <typename T>
+void ParsevalTracker<T>::Add(const HarmonicCoefficient<T>& coefficient) {
+    ++count_;
+
+    const int n = coefficient.index;
+    const bool nyquist = periodic_samples_ > 0 && periodic_samples_ % 2 == 0 && n == periodic_samples_ / 2;
+    if (periodic_samples_ > 0 && n > periodic_samples_ / 2) {
+        ++aliased_;
+        return;
+    }
+
+    // The constant term a_0 / 2 holds a^2 / 4. On the grid the Nyquist cosine and sine are the
+    // same alternating sequence (-1)^k scaled by cos and sin of the range start's phase, so a
+    // and b both measure its one amplitude A and a^2 + b^2 = 4 A^2 whatever the start.
+    const double a = static_cast<double>(coefficient.a);
+    const double b = static_cast<double>(coefficient.b);
+    if (n == 0) {
+        captured_.Add(a * a / 4.0);
+    } else {
+        captured_.Add(nyquist ? (a * a + b * b) / 4.0 : (a * a + b * b) / 2.0);
+    }
+}
+
+template <typename T>
+size_t ParsevalTracker<T>::AddUntil(const std::vector<HarmonicCoefficient<T>>& coefficients, double tolerance, size_t first) {
+    size_t next = first;
+    while (next < coefficients.size() && !Meets(tolerance)) {
+        Add(coefficients[next]);
+        ++next;
+    }
+    return next - first;
+}
+
+template <typename T>
+double ParsevalTracker<T>::GetMeanSquareError() const {
+    return std::max(signal_energy_ - captured_.Result(), 0.0);
+}
+
+template <typename T>
+bool ParsevalTracker<T>::IsReliable() const {
+    return aliased_ == 0 && captured_.Result() - signal_energy_ <= kEnergySlack * signal_energy_;
+}
+
+template <typename T>
+ConvergenceReport ParsevalTracker<T>::GetReport() const {
+    const double error = GetMeanSquareError();
+    return {count_, signal_energy_, captured_.Result(), error, (signal_energy_ > 0.0) ? error / signal_energy_ : 0.0, 
+            aliased_, IsReliable()};
+}
+
+template double SignalEnergy<float>(QuadratureRule, const std::vector<float>&);
+template double SignalEnergy<double>(QuadratureRule, const std::vector<double>&);
+template double SignalEnergy<long double>(QuadratureRule, const std::vector<long double>&);
+
+template class ParsevalTracker<float>;
+template class ParsevalTracker<double>;
+template class ParsevalTracker<long double>;
+
+} // namespace fourier_sim
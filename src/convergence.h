@@ -0,0 +1,71 @@
+#ifndef CONVERGENCE_H_
+#define CONVERGENCE_H_
+
+#include <cstddef>
+#include <vector>
+#include "coefficient_engine.h"
+#include "quadrature.h"
+#include "summation.h"
+
+namespace fourier_sim {
+
+struct ConvergenceReport {
+    int coefficients;          // Coefficients counted so far
+    double signal_energy;      // Mean of f^2 over the range
+    double captured_energy;    // a_0^2 / 4 + sum (a_n^2 + b_n^2) / 2
+    double mean_square_error;  // Mean of (f - S)^2, the difference of the two above
+    double relative_error;     // mean_square_error / signal_energy, 0 for f = 0
+    int aliased;               // Coefficients past the Nyquist index, left out of the sum
+    bool reliable;             // False once aliased coefficients came in or the sum overshot
+};
+
+// Mean of f^2 over the range from samples laid out as QuadratureSampleCount describes:
+// the left sum for kRiemann, composite Simpson for the closed rules. One pass, no trig.
+// Instantiated for float, double and long double in convergence.cpp.
+template <typename T>
+double SignalEnergy(QuadratureRule rule, const std::vector<T>& samples);
+
+// Parseval: the mean-square error of a truncated orthogonal series is the signal energy
+// minus the energy of the coefficients kept, so each added harmonic updates it in O(1)
+// and the series is never evaluated. Holds for distinct indices whose coefficients and
+// energy came from the same f. The error floor is rounding, about 1e-16 of the signal
+// energy (1e-7 with float coefficients).
+//
+// Coefficients that are trig sums over N periodic samples (periodic_samples = N) only
+// carry N / 2 harmonics: an even N's Nyquist term counts a^2 / 4 and higher indices
+// repeat lower ones, so they are not summed and the report is marked unreliable.
+template <typename T>
+class ParsevalTracker {
+
+    public:
+        // periodic_samples 0 for coefficients that do not alias (closed forms, Filon)
+        void Reset(double signal_energy, int periodic_samples = 0);
+
+        // Drops the coefficients added so far, keeps the energy and the sample count
+        void Clear();
+
+        void Add(const HarmonicCoefficient<T>& coefficient);
+
+        // Adds coefficients in order from first on until the error is at most tolerance,
+        // returns how many were added
+        size_t AddUntil(const std::vector<HarmonicCoefficient<T>>& coefficients, double tolerance, size_t first = 0);
+
+        double GetMeanSquareError() const;
+        bool IsReliable() const;
+
+        // An unreliable error never meets a tolerance, a stop on it would be premature
+        bool Meets(double tolerance) const { return IsReliable() && GetMeanSquareError() <= tolerance; }
+        ConvergenceReport GetReport() const;
+
+    private:
+        double signal_energy_ = 0.0;
+        int periodic_samples_ = 0;
+        NeumaierSum<double> captured_;
+        int count_ = 0;
+        int aliased_ = 0;
+
+};
+
+} // namespace fourier_sim
+
+#endif  // CONVERGENCE_H_
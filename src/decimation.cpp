@@ -0,0 +1,127 @@
+#include "decimation.h"
+#include <cmath>
+#include <utility>
+
+namespace fourier_sim {
+
+namespace {
+    // RDP tolerance in columns, below what a one pixel wide line can show
+    const float kRdpTolerance = 0.5f;
+
+    float DistanceToChord(const sf::Vector2f& p, const sf::Vector2f& a, const sf::Vector2f& b) {
+        const sf::Vector2f chord = b - a;
+        const sf::Vector2f offset = p - a;
+        const float length = std::hypot(chord.x, chord.y);
+        if (length == 0.f) {
+            return std::hypot(offset.x, offset.y);
+        }
+        return std::abs(chord.x * offset.y - chord.y * offset.x) / length;
+    }
+} // namespace
+
+const char* DecimationName(DecimationMode mode) {
+    switch (mode) {
+        case DecimationMode::kNone: return "none";
+        case DecimationMode::kMinMax: return "min/max";
+        case DecimationMode::kRdp: return "rdp";
+    }
+    return "unknown";
+}
+
+std::vector<sf::Vertex> DecimateMinMax(const std::vector<sf::Vertex>& vertices, float column_width) {
+    const size_t count = vertices.size();
+    if (count < 3 || !(column_width > 0.f)) {
+        return vertices;
+    }
+
+    const float x_begin = vertices.front().position.x;
+    const float span = vertices.back().position.x - x_begin;
+    if (!(span / column_width * 2.f < static_cast<float>(count))) {
+        return vertices;
+    }
+
+    std::vector<sf::Vertex> decimated;
+    decimated.reserve(2 * static_cast<size_t>(span / column_width) + 4);
+    decimated.push_back(vertices.front());
+
+    size_t i = 1;
+    while (i + 1 < count) {
+        const long column = static_cast<long>(std::floor((vertices[i].position.x - x_begin) / column_width));
+
+        size_t low = i;
+        size_t high = i;
+        size_t j = i + 1;
+        for (; j + 1 < count && static_cast<long>(std::floor((vertices[j].position.x - x_begin) / column_width)) == column; ++j) {
+            if (vertices[j].position.y < vertices[low].position.y) {
+                low = j;
+            }
+            if (vertices[j].position.y > vertices[high].position.y) {
+                high = j;
+            }
+        }
+
+        if (low > high) {
+            std::swap(low, high);
+        }
+        decimated.push_back(vertices[low]);
+        if (high != low) {
+            decimated.push_back(vertices[high]);
+        }
+        i = j;
+    }
+
+    decimated.push_back(vertices.back());
+    return decimated;
+}
+
+std::vector<sf::Vertex> DecimateRdp(const std::vector<sf::Vertex>& vertices, float tolerance) {
+    const size_t count = vertices.size();
+    if (count < 3) {
+        return vertices;
+    }
+
+    // Explicit stack of (first, last) spans, a recursion would go as deep as the strip is long
+    std::vector<char> keep(count, 0);
+    keep.front() = keep.back() = 1;
+    std::vector<std::pair<size_t, size_t>> spans = {{0, count - 1}};
+
+    while (!spans.empty()) {
+        const auto [first, last] = spans.back();
+        spans.pop_back();
+
+        float farthest = 0.f;
+        size_t split = first;
+        for (size_t k = first + 1; k < last; ++k) {
+            const float distance = DistanceToChord(vertices[k].position, vertices[first].position, vertices[last].position);
+            if (distance > farthest) {
+                farthest = distance;
+                split = k;
+            }
+        }
+
+        if (farthest > tolerance) {
+            keep[split] = 1;
+            spans.push_back({first, split});
+            spans.push_back({split, last});
+        }
+    }
+
+    std::vector<sf::Vertex> simplified;
+    for (size_t k = 0; k < count; ++k) {
+        if (keep[k]) {
+            simplified.push_back(vertices[k]);
+        }
+    }
+    return simplified;
+}
+
+std::vector<sf::Vertex> Decimate(const std::vector<sf::Vertex>& vertices, DecimationMode mode, float column_width) {
+    switch (mode) {
+        case DecimationMode::kNone: return vertices;
+        case DecimationMode::kMinMax: return DecimateMinMax(vertices, column_width);
+        case DecimationMode::kRdp: return DecimateRdp(DecimateMinMax(vertices, column_width), kRdpTolerance * column_width);
+    }
+    return vertices;
+}
+
+} // namespace fourier_sim
@@ -0,0 +1,30 @@
+#ifndef DECIMATION_H_
+#define DECIMATION_H_
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+namespace fourier_sim {
+
+enum class DecimationMode {
+    kNone,
+    kMinMax,  // Lowest and highest vertex of every pixel column, about 2 per column
+    kRdp      // Min/max, then Ramer-Douglas-Peucker within a pixel tolerance
+};
+
+const char* DecimationName(DecimationMode mode);
+
+// Reduces a line strip sorted by x to at most two vertices per column of column_width,
+// the column's extremes in their original order, so overshoots such as the Gibbs peaks
+// survive exactly. Strips no denser than the columns come back unchanged.
+std::vector<sf::Vertex> DecimateMinMax(const std::vector<sf::Vertex>& vertices, float column_width = 1.f);
+
+// Drops every vertex the simplified strip passes within tolerance of; endpoints
+// and any vertex farther than tolerance from its chord are kept
+std::vector<sf::Vertex> DecimateRdp(const std::vector<sf::Vertex>& vertices, float tolerance = 0.5f);
+
+std::vector<sf::Vertex> Decimate(const std::vector<sf::Vertex>& vertices, DecimationMode mode, float column_width = 1.f);
+
+} // namespace fourier_sim
+
+#endif  // DECIMATION_H_
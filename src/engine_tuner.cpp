@@ -0,0 +1,232 @@
+#include "engine_tuner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace fourier_sim {
+
+namespace {
+    const char* kWisdomHeader = "fourier_wisdom 2";
+    const int kRepetitions = 3;
+
+    // An engine slower than this factor times the best one is not measured again
+    // at larger harmonic counts for the same slices, its cost only grows with them
+    const double kGiveUpRatio = 2.0;
+
+    const EngineKind kCandidates[] = {EngineKind::kDirect, EngineKind::kFft, EngineKind::kGoertzel};
+
+    // Until a table is measured: the FFT costs about slices log2(slices) whatever the count,
+    // Goertzel about harmonic_count * slices without trig, so the FFT wins past a few log2(slices)
+    const double kFftCrossover = 2.0;
+
+    EngineKind EstimateEngine(int harmonic_count, int slices) {
+        return (harmonic_count > kFftCrossover * std::log2(static_cast<double>(std::max(slices, 2)))) ? EngineKind::kFft 
+                                                                                                       : EngineKind::kGoertzel;
+    }
+
+    template <typename T>
+    double MeasureSeconds(EngineKind kind, const std::vector<T>& samples, const std::vector<int>& indices) {
+        double best = 1e30;
+        for (int r = 0; r < kRepetitions; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<HarmonicCoefficient<T>> result = ComputeCoefficients(kind, samples, T(0), T(16), indices);
+            auto stop = std::chrono::steady_clock::now();
+
+            // Keep the result observable so the call is not optimized away
+            if (!result.empty() && std::isnan(result.back().a)) {
+                return 1e30;
+            }
+            best = std::min(best, std::chrono::duration<double>(stop - start).count());
+        }
+        return best;
+    }
+
+    bool ParseEngine(const std::string& name, EngineKind& kind) {
+        for (EngineKind candidate : kCandidates) {
+            if (name == EngineName(candidate)) {
+                kind = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace
+
+const char* ScalarName(ScalarKind kind) {
+    switch (kind) {
+        case ScalarKind::kFloat: return "float";
+        case ScalarKind::kDouble: return "double";
+        case ScalarKind::kLongDouble: return "long_double";
+    }
+    return "unknown";
+}
+
+EngineTuner::EngineTuner(ScalarKind scalar) 
+    : scalar_(scalar),
+      harmonic_buckets_{1, 4, 16, 64, 256, 1024},
+      slice_buckets_{16, 64, 256, 1024, 4096, 16384},
+      table_(harmonic_buckets_.size() * slice_buckets_.size(), EngineKind::kDirect) {
+    for (size_t h = 0; h < harmonic_buckets_.size(); ++h) {
+        for (size_t s = 0; s < slice_buckets_.size(); ++s) {
+            Cell(static_cast<int>(h), static_cast<int>(s)) = EstimateEngine(harmonic_buckets_[h], slice_buckets_[s]);
+        }
+    }
+}
+
+EngineKind EngineTuner::Select(int harmonic_count, int slices) const {
+    return Cell(NearestBucket(harmonic_buckets_, harmonic_count), NearestBucket(slice_buckets_, slices));
+}
+
+void EngineTuner::Tune() {
+    switch (scalar_) {
+        case ScalarKind::kFloat: TuneWith<float>(); break;
+        case ScalarKind::kDouble: TuneWith<double>(); break;
+        case ScalarKind::kLongDouble: TuneWith<long double>(); break;
+    }
+}
+
+template <typename T>
+void EngineTuner::TuneWith() {
+    for (size_t s = 0; s < slice_buckets_.size(); ++s) {
+        const int slices = slice_buckets_[s];
+
+        std::vector<T> samples(slices);
+        for (int i = 0; i < slices; ++i) {
+            T x = T(16) * i / slices;
+            samples[i] = std::sin(x * x) + x / T(10);
+        }
+
+        bool alive[3] = {true, true, true};
+        for (size_t h = 0; h < harmonic_buckets_.size(); ++h) {
+            std::vector<int> indices(harmonic_buckets_[h]);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                indices[i] = static_cast<int>(i);
+            }
+
+            double times[3];
+            double best_time = 1e30;
+            for (int e = 0; e < 3; ++e) {
+                times[e] = alive[e] ? MeasureSeconds(kCandidates[e], samples, indices) : 1e30;
+                if (times[e] < best_time) {
+                    best_time = times[e];
+                    Cell(static_cast<int>(h), static_cast<int>(s)) = kCandidates[e];
+                }
+            }
+
+            for (int e = 0; e < 3; ++e) {
+                // The FFT cost does not depend on the harmonic count, keep it measured
+                if (kCandidates[e] != EngineKind::kFft && times[e] > kGiveUpRatio * best_time) {
+                    alive[e] = false;
+                }
+            }
+        }
+    }
+
+    tuned_ = true;
+}
+
+bool EngineTuner::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != kWisdomHeader) {
+        return false;
+    }
+
+    // Crossovers measured with another scalar type's kernels do not apply
+    if (!std::getline(file, line) || line != std::string("scalar ") + ScalarName(scalar_)) {
+        return false;
+    }
+
+    // Bucket grids must match, otherwise the file belongs to another version
+    auto read_buckets = [&file](const std::string& name, const std::vector<int>& expected) {
+        std::string row_text;
+        if (!std::getline(file, row_text)) {
+            return false;
+        }
+        std::istringstream row(row_text);
+        std::string label;
+        row >> label;
+        std::vector<int> values;
+        int value = 0;
+        while (row >> value) {
+            values.push_back(value);
+        }
+        return label == name && values == expected;
+    };
+
+    if (!read_buckets("harmonic_buckets", harmonic_buckets_) || !read_buckets("slice_buckets", slice_buckets_)) {
+        return false;
+    }
+
+    std::vector<EngineKind> table(table_.size());
+    for (EngineKind& cell : table) {
+        std::string name;
+        if (!(file >> name) || !ParseEngine(name, cell)) {
+            return false;
+        }
+    }
+
+    table_ = table;
+    tuned_ = true;
+    return true;
+}
+
+bool EngineTuner::Save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    file << kWisdomHeader << "\n";
+    file << "scalar " << ScalarName(scalar_) << "\n";
+    file << "harmonic_buckets";
+    for (int value : harmonic_buckets_) {
+        file << " " << value;
+    }
+    file << "\nslice_buckets";
+    for (int value : slice_buckets_) {
+        file << " " << value;
+    }
+    file << "\n";
+
+    // One row per harmonic bucket, one column per slice bucket
+    for (size_t h = 0; h < harmonic_buckets_.size(); ++h) {
+        for (size_t s = 0; s < slice_buckets_.size(); ++s) {
+            file << (s == 0 ? "" : " ") << EngineName(table_[h * slice_buckets_.size() + s]);
+        }
+        file << "\n";
+    }
+
+    return static_cast<bool>(file);
+}
+
+int EngineTuner::NearestBucket(const std::vector<int>& buckets, int value) {
+    const double target = std::log(static_cast<double>(std::max(value, 1)));
+
+    int best = 0;
+    double best_distance = 1e30;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        double distance = std::abs(std::log(static_cast<double>(buckets[i])) - target);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+EngineKind& EngineTuner::Cell(int harmonic_bucket, int slice_bucket) {
+    return table_[harmonic_bucket * slice_buckets_.size() + slice_bucket];
+}
+
+const EngineKind& EngineTuner::Cell(int harmonic_bucket, int slice_bucket) const {
+    return table_[harmonic_bucket * slice_buckets_.size() + slice_bucket];
+}
+
+} // namespace fourier_sim
@@ -0,0 +1,68 @@
+#ifndef ENGINE_TUNER_H_
+#define ENGINE_TUNER_H_
+
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+enum class ScalarKind {
+    kFloat,
+    kDouble,
+    kLongDouble
+};
+
+const char* ScalarName(ScalarKind kind);
+
+template <typename T>
+constexpr ScalarKind ScalarKindOf() {
+    return std::is_same_v<T, float> ? ScalarKind::kFloat : std::is_same_v<T, double> ? ScalarKind::kDouble : ScalarKind::kLongDouble;
+}
+
+// Crossover table between coefficient engines for one scalar type, since the
+// float, double and long double kernels do not cost the same. Until a table is
+// loaded or measured, Select answers from a static estimate, so no request ever
+// waits for a benchmark; Tune runs only when the owner asks for it.
+// Like FFTW wisdom, a measured table is kept in a small text file chosen by the
+// caller, one file per scalar type.
+class EngineTuner {
+
+    public:
+        explicit EngineTuner(ScalarKind scalar = ScalarKind::kFloat);
+
+        // Fastest engine for computing harmonic_count coefficients from slices samples
+        EngineKind Select(int harmonic_count, int slices) const;
+
+        // Benchmarks every engine on the bucket grid with this scalar type's kernels,
+        // replacing the current table. Takes a few hundred milliseconds.
+        void Tune();
+
+        // False when the file is missing or was written for another grid or scalar type
+        bool Load(const std::string& path);
+        bool Save(const std::string& path) const;
+
+        bool IsTuned() const { return tuned_; }
+        ScalarKind GetScalar() const { return scalar_; }
+
+    private:
+        template <typename T>
+        void TuneWith();
+
+        static int NearestBucket(const std::vector<int>& buckets, int value);
+        EngineKind& Cell(int harmonic_bucket, int slice_bucket);
+        const EngineKind& Cell(int harmonic_bucket, int slice_bucket) const;
+
+        ScalarKind scalar_;
+        bool tuned_ = false;
+
+        std::vector<int> harmonic_buckets_;
+        std::vector<int> slice_buckets_;
+        std::vector<EngineKind> table_;
+
+};
+
+} // namespace fourier_sim
+
+#endif  // ENGINE_TUNER_H_
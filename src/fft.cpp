@@ -0,0 +1,534 @@
+// The mixed-radix core (factorization, radix 2, 4, 5 and generic butterflies,
+// strided recursion) is derived from KISS FFT:
+//
+// Copyright (c) 2003-2010, Mark Borgerding. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the author nor the names of any contributors may be used to endorse
+//     or promote products derived from this software without specific prior
+//     written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace fourier_sim {
+
+namespace {
+    const double kTwoPi = 2.0 * 3.14159265358979323846;
+
+    std::vector<int> Factorize(int n) {
+        std::vector<int> factors;
+        int p = 4;
+        const int floor_sqrt = static_cast<int>(std::floor(std::sqrt(static_cast<double>(n))));
+
+        // Powers of 4 first, then 2, then odd primes
+        do {
+            while (n % p) {
+                switch (p) {
+                    case 4: p = 2; break;
+                    case 2: p = 3; break;
+                    default: p += 2; break;
+                }
+                if (p > floor_sqrt) {
+                    p = n;
+                }
+            }
+            n /= p;
+            factors.push_back(p);
+            factors.push_back(n);
+        } while (n > 1);
+
+        return factors;
+    }
+
+    // Twiddles are finite, so the NaN recovery of the std::complex product is not needed
+    inline std::complex<double> MultiplyTwiddle(const std::complex<double>& x, const std::complex<double>& w) {
+        return {x.real() * w.real() - x.imag() * w.imag(), x.real() * w.imag() + x.imag() * w.real()};
+    }
+
+    const char kPlanFileMagic[8] = {'F', 'F', 'T', 'P', 'L', 'A', 'N', '1'};
+
+    template <typename T>
+    void WriteValue(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool ReadValue(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    template <typename T>
+    void WriteVector(std::ostream& out, const std::vector<T>& values) {
+        WriteValue(out, static_cast<std::uint64_t>(values.size()));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    // Largest plan read back from a file, bigger ones are planned again
+    const std::int32_t kMaxLoadedPlanSize = 1 << 24;
+
+    // A factor chain holds one (radix, remaining) pair per factor, at most log2 of the size
+    const std::uint64_t kMaxFactorEntries = 64;
+
+    template <typename T>
+    bool ReadVector(std::istream& in, std::vector<T>& values, std::uint64_t max_count) {
+        std::uint64_t count = 0;
+        // Refuse counts the plan cannot need before allocating
+        if (!ReadValue(in, count) || count > max_count) {
+            return false;
+        }
+        values.resize(count);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+    }
+} // namespace
+
+FftPlan::FftPlan(int size, bool inverse) : size_(size), inverse_(inverse) {
+    if (size_ <= 1) {
+        return;
+    }
+
+    factors_ = Factorize(size_);
+
+    int largest_radix = 0;
+    for (size_t i = 0; i < factors_.size(); i += 2) {
+        largest_radix = std::max(largest_radix, factors_[i]);
+    }
+
+    if (largest_radix <= kMaxDirectRadix) {
+        const double sign = inverse_ ? 1.0 : -1.0;
+        twiddles_.resize(size_);
+        for (int i = 0; i < size_; ++i) {
+            twiddles_[i] = std::polar(1.0, sign * kTwoPi * i / size_);
+        }
+        return;
+    }
+
+    // Bluestein: X_k = c_k * sum_j (x_j c_j) conj(c_{k-j}), with c_k = e^{-i pi k^2 / N}
+    factors_.clear();
+
+    int padded = 1;
+    while (padded < 2 * size_ - 1) {
+        padded *= 2;
+    }
+
+    const double sign = inverse_ ? 1.0 : -1.0;
+    chirp_.resize(size_);
+    for (int k = 0; k < size_; ++k) {
+        // k^2 mod 2N keeps the angle small for large k
+        long long k_sq = (static_cast<long long>(k) * k) % (2LL * size_);
+        chirp_[k] = std::polar(1.0, sign * kTwoPi * 0.5 * static_cast<double>(k_sq) / size_);
+    }
+
+    padded_forward_ = std::make_unique<FftPlan>(padded, false);
+    padded_inverse_ = std::make_unique<FftPlan>(padded, true);
+
+    std::vector<std::complex<double>> kernel(padded, 0.0);
+    kernel[0] = std::conj(chirp_[0]);
+    for (int k = 1; k < size_; ++k) {
+        kernel[k] = std::conj(chirp_[k]);
+        kernel[padded - k] = std::conj(chirp_[k]);
+    }
+
+    chirp_spectrum_.resize(padded);
+    padded_forward_->Execute(kernel.data(), chirp_spectrum_.data());
+}
+
+void FftPlan::Execute(const std::complex<double>* in, std::complex<double>* out) const {
+    if (size_ <= 1) {
+        if (size_ == 1) {
+            out[0] = in[0];
+        }
+        return;
+    }
+
+    if (!chirp_.empty()) {
+        ExecuteBluestein(in, out);
+        return;
+    }
+
+    Transform(out, in, 1, factors_.data());
+}
+
+void FftPlan::Transform(std::complex<double>* out, const std::complex<double>* in, int fstride, const int* factors) const {
+    std::complex<double>* out_begin = out;
+    const int p = factors[0];
+    const int m = factors[1];
+    std::complex<double>* out_end = out + p * m;
+
+    if (m == 1) {
+        do {
+            *out = *in;
+            in += fstride;
+        } while (++out != out_end);
+    } else {
+        do {
+            Transform(out, in, fstride * p, factors + 2);
+            in += fstride;
+        } while ((out += m) != out_end);
+    }
+
+    switch (p) {
+        case 2: Butterfly2(out_begin, fstride, m); break;
+        case 4: Butterfly4(out_begin, fstride, m); break;
+        case 5: Butterfly5(out_begin, fstride, m); break;
+        default: ButterflyGeneric(out_begin, fstride, m, p); break;
+    }
+}
+
+void FftPlan::Butterfly2(std::complex<double>* out, int fstride, int m) const {
+    std::complex<double>* out2 = out + m;
+    for (int u = 0; u < m; ++u) {
+        std::complex<double> t = out2[u] * twiddles_[u * fstride];
+        out2[u] = out[u] - t;
+        out[u] += t;
+    }
+}
+
+void FftPlan::Butterfly4(std::complex<double>* out, int fstride, int m) const {
+    for (int u = 0; u < m; ++u) {
+        std::complex<double> s0 = out[u + m] * twiddles_[u * fstride];
+        std::complex<double> s1 = out[u + 2 * m] * twiddles_[2 * u * fstride];
+        std::complex<double> s2 = out[u + 3 * m] * twiddles_[3 * u * fstride];
+
+        std::complex<double> s5 = out[u] - s1;
+        out[u] += s1;
+        std::complex<double> s3 = s0 + s2;
+        std::complex<double> s4 = s0 - s2;
+
+        out[u + 2 * m] = out[u] - s3;
+        out[u] += s3;
+
+        // Multiply s4 by -i (forward) or +i (inverse)
+        std::complex<double> rotated = inverse_ ? std::complex<double>(-s4.imag(), s4.real())
+                                                : std::complex<double>(s4.imag(), -s4.real());
+        out[u + m] = s5 + rotated;
+        out[u + 3 * m] = s5 - rotated;
+    }
+}
+
+void FftPlan::Butterfly5(std::complex<double>* out, int fstride, int m) const {
+    // Decimal grid sizes are 2^a 5^b; the generic butterfly costs p^2 complex products
+    // per point and would dominate them. The twiddles are e^{-+2 pi i / 5}, e^{-+4 pi i / 5}.
+    const std::complex<double> ya = twiddles_[fstride * m];
+    const std::complex<double> yb = twiddles_[2 * fstride * m];
+
+    std::complex<double>* out0 = out;
+    std::complex<double>* out1 = out + m;
+    std::complex<double>* out2 = out + 2 * m;
+    std::complex<double>* out3 = out + 3 * m;
+    std::complex<double>* out4 = out + 4 * m;
+
+    for (int u = 0; u < m; ++u) {
+        const std::complex<double> s0 = out0[u];
+        const std::complex<double> s1 = MultiplyTwiddle(out1[u], twiddles_[u * fstride]);
+        const std::complex<double> s2 = MultiplyTwiddle(out2[u], twiddles_[2 * u * fstride]);
+        const std::complex<double> s3 = MultiplyTwiddle(out3[u], twiddles_[3 * u * fstride]);
+        const std::complex<double> s4 = MultiplyTwiddle(out4[u], twiddles_[4 * u * fstride]);
+
+        const std::complex<double> s7 = s1 + s4;
+        const std::complex<double> s10 = s1 - s4;
+        const std::complex<double> s8 = s2 + s3;
+        const std::complex<double> s9 = s2 - s3;
+
+        out0[u] = s0 + s7 + s8;
+
+        const std::complex<double> s5(s0.real() + s7.real() * ya.real() + s8.real() * yb.real(),
+                                      s0.imag() + s7.imag() * ya.real() + s8.imag() * yb.real());
+        const std::complex<double> s6(s10.imag() * ya.imag() + s9.imag() * yb.imag(),
+                                      -s10.real() * ya.imag() - s9.real() * yb.imag());
+        out1[u] = s5 - s6;
+        out4[u] = s5 + s6;
+
+        const std::complex<double> s11(s0.real() + s7.real() * yb.real() + s8.real() * ya.real(),
+                                       s0.imag() + s7.imag() * yb.real() + s8.imag() * ya.real());
+        const std::complex<double> s12(-s10.imag() * yb.imag() + s9.imag() * ya.imag(),
+                                       s10.real() * yb.imag() - s9.real() * ya.imag());
+        out2[u] = s11 + s12;
+        out3[u] = s11 - s12;
+    }
+}
+
+void FftPlan::ButterflyGeneric(std::complex<double>* out, int fstride, int m, int p) const {
+    std::complex<double> scratch[kMaxDirectRadix];
+
+    for (int u = 0; u < m; ++u) {
+        int k = u;
+        for (int q1 = 0; q1 < p; ++q1) {
+            scratch[q1] = out[k];
+            k += m;
+        }
+
+        k = u;
+        for (int q1 = 0; q1 < p; ++q1) {
+            int twiddle_index = 0;
+            out[k] = scratch[0];
+            for (int q = 1; q < p; ++q) {
+                twiddle_index += fstride * k;
+                if (twiddle_index >= size_) {
+                    twiddle_index -= size_;
+                }
+                out[k] += scratch[q] * twiddles_[twiddle_index];
+            }
+            k += m;
+        }
+    }
+}
+
+void FftPlan::ExecuteBluestein(const std::complex<double>* in, std::complex<double>* out) const {
+    const int padded = padded_forward_->GetSize();
+
+    std::vector<std::complex<double>> work(padded, 0.0);
+    for (int k = 0; k < size_; ++k) {
+        work[k] = in[k] * chirp_[k];
+    }
+
+    std::vector<std::complex<double>> spectrum(padded);
+    padded_forward_->Execute(work.data(), spectrum.data());
+    for (int k = 0; k < padded; ++k) {
+        spectrum[k] *= chirp_spectrum_[k];
+    }
+    padded_inverse_->Execute(spectrum.data(), work.data());
+
+    const double scale = 1.0 / padded;
+    for (int k = 0; k < size_; ++k) {
+        out[k] = work[k] * chirp_[k] * scale;
+    }
+}
+
+size_t FftPlan::MemoryBytes() const {
+    size_t bytes = sizeof(FftPlan);
+    bytes += factors_.capacity() * sizeof(int);
+    bytes += (twiddles_.capacity() + chirp_.capacity() + chirp_spectrum_.capacity()) * sizeof(std::complex<double>);
+    if (padded_forward_) {
+        bytes += padded_forward_->MemoryBytes();
+    }
+    if (padded_inverse_) {
+        bytes += padded_inverse_->MemoryBytes();
+    }
+    return bytes;
+}
+
+void FftPlan::Serialize(std::ostream& out) const {
+    WriteValue(out, static_cast<std::int32_t>(size_));
+    WriteValue(out, static_cast<std::int32_t>(inverse_ ? 1 : 0));
+    WriteVector(out, factors_);
+    WriteVector(out, twiddles_);
+    WriteVector(out, chirp_);
+    WriteVector(out, chirp_spectrum_);
+
+    if (!chirp_.empty()) {
+        padded_forward_->Serialize(out);
+        padded_inverse_->Serialize(out);
+    }
+}
+
+std::unique_ptr<FftPlan> FftPlan::Deserialize(std::istream& in) {
+    std::int32_t size = 0;
+    std::int32_t inverse = 0;
+    if (!ReadValue(in, size) || !ReadValue(in, inverse) || size < 0 || size > kMaxLoadedPlanSize) {
+        return nullptr;
+    }
+
+    std::unique_ptr<FftPlan> plan(new FftPlan());
+    plan->size_ = size;
+    plan->inverse_ = inverse != 0;
+
+    // Bluestein pads to the next power of two of at least 2 size - 1, under 4 size
+    const std::uint64_t count = static_cast<std::uint64_t>(size);
+    if (!ReadVector(in, plan->factors_, kMaxFactorEntries) || !ReadVector(in, plan->twiddles_, count) ||
+        !ReadVector(in, plan->chirp_, count) || !ReadVector(in, plan->chirp_spectrum_, 4 * count)) {
+        return nullptr;
+    }
+
+    if (!plan->chirp_.empty()) {
+        plan->padded_forward_ = Deserialize(in);
+        plan->padded_inverse_ = Deserialize(in);
+        if (!plan->padded_forward_ || !plan->padded_inverse_) {
+            return nullptr;
+        }
+    }
+
+    return plan->IsConsistent() ? std::move(plan) : nullptr;
+}
+
+bool FftPlan::IsConsistent() const {
+    if (size_ <= 1) {
+        return factors_.empty() && twiddles_.empty() && chirp_.empty() && chirp_spectrum_.empty() && !padded_forward_ && !padded_inverse_;
+    }
+
+    if (!chirp_.empty()) {
+        // Forward and inverse sub-plans of one padded size, long enough for the linear convolution
+        if (!factors_.empty() || !twiddles_.empty() || static_cast<int>(chirp_.size()) != size_ ||
+            !padded_forward_ || !padded_inverse_ || padded_forward_->IsInverse() || !padded_inverse_->IsInverse()) {
+            return false;
+        }
+        const int padded = padded_forward_->GetSize();
+        return padded_inverse_->GetSize() == padded && padded >= 2 * size_ - 1 && 
+               chirp_spectrum_.size() == static_cast<size_t>(padded);
+    }
+
+    // Transform recurses through the (p, m) pairs with a stack scratch of kMaxDirectRadix,
+    // so every radix must fit it and each m must be exactly what is left after p
+    if (padded_forward_ || padded_inverse_ || !chirp_spectrum_.empty() || static_cast<int>(twiddles_.size()) != size_ ||
+        factors_.empty() || factors_.size() % 2 != 0) {
+        return false;
+    }
+    int remaining = size_;
+    for (size_t i = 0; i < factors_.size(); i += 2) {
+        const int p = factors_[i];
+        const int m = factors_[i + 1];
+        if (p < 2 || p > kMaxDirectRadix || remaining % p != 0 || m != remaining / p) {
+            return false;
+        }
+        remaining = m;
+    }
+    return remaining == 1;
+}
+
+FftPlanCache::FftPlanCache(size_t memory_budget_bytes) : memory_budget_bytes_(memory_budget_bytes) {}
+
+std::shared_ptr<const FftPlan> FftPlanCache::Acquire(int size, FftKind kind) {
+    const Key key = MakeKey(size, kind);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(key);
+        if (found != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, found->second.lru_position);
+            return found->second.plan;
+        }
+    }
+
+    // Plan outside the lock, another thread may plan the same size meanwhile
+    auto plan = std::make_shared<const FftPlan>(size, kind == FftKind::kInverse);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Insert(key, plan);
+    return plan;
+}
+
+void FftPlanCache::SetMemoryBudget(size_t memory_budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_budget_bytes_ = memory_budget_bytes;
+    EvictToBudget();
+}
+
+size_t FftPlanCache::GetMemoryUsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_used_;
+}
+
+size_t FftPlanCache::GetPlanCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void FftPlanCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    memory_used_ = 0;
+}
+
+bool FftPlanCache::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    file.write(kPlanFileMagic, sizeof(kPlanFileMagic));
+    WriteValue(file, static_cast<std::uint64_t>(entries_.size()));
+
+    // Least recently used first, so Load() rebuilds the same order
+    for (auto key = lru_.rbegin(); key != lru_.rend(); ++key) {
+        entries_.at(*key).plan->Serialize(file);
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool FftPlanCache::Load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    char magic[sizeof(kPlanFileMagic)];
+    std::uint64_t count = 0;
+    if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kPlanFileMagic) || !ReadValue(file, count)) {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<const FftPlan>> plans;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::shared_ptr<const FftPlan> plan = FftPlan::Deserialize(file);
+        if (!plan) {
+            return false;
+        }
+        plans.push_back(plan);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& plan : plans) {
+        Key key = MakeKey(plan->GetSize(), plan->IsInverse() ? FftKind::kInverse : FftKind::kForward);
+        if (entries_.find(key) == entries_.end()) {
+            Insert(key, plan);
+        }
+    }
+    return true;
+}
+
+FftPlanCache::Key FftPlanCache::MakeKey(int size, FftKind kind) {
+    return (static_cast<Key>(size) << 1) | (kind == FftKind::kInverse ? 1u : 0u);
+}
+
+void FftPlanCache::Insert(Key key, std::shared_ptr<const FftPlan> plan) {
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, found->second.lru_position);
+        return;
+    }
+
+    lru_.push_front(key);
+    memory_used_ += plan->MemoryBytes();
+    entries_[key] = {std::move(plan), lru_.begin()};
+    EvictToBudget();
+}
+
+void FftPlanCache::EvictToBudget() {
+    // Always keep the newest plan, even when it alone exceeds the budget
+    while (memory_used_ > memory_budget_bytes_ && lru_.size() > 1) {
+        Key oldest = lru_.back();
+        memory_used_ -= entries_.at(oldest).plan->MemoryBytes();
+        entries_.erase(oldest);
+        lru_.pop_back();
+    }
+}
+
+FftPlanCache& DefaultPlanCache() {
+    static FftPlanCache cache;
+    return cache;
+}
+
+} // namespace fourier_sim
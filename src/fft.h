@@ -0,0 +1,121 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <complex>
+#include <cstdint>
+#include <iosfwd>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fourier_sim {
+
+// Mixed-radix complex FFT of any size. Sizes with a prime factor above
+// kMaxDirectRadix go through Bluestein's chirp-z on a power of two.
+// Inverse transforms are not scaled by 1/N. The mixed-radix core is derived
+// from KISS FFT (BSD-3-Clause), see the notice at the top of fft.cpp.
+class FftPlan {
+
+    public:
+        FftPlan(int size, bool inverse);
+
+        int GetSize() const { return size_; }
+        bool IsInverse() const { return inverse_; }
+
+        // in and out must not overlap, both hold GetSize() values
+        void Execute(const std::complex<double>* in, std::complex<double>* out) const;
+
+        // Bytes held by twiddles, factors and Bluestein sub-plans
+        size_t MemoryBytes() const;
+
+        void Serialize(std::ostream& out) const;
+        // Returns nullptr on truncated or inconsistent input
+        static std::unique_ptr<FftPlan> Deserialize(std::istream& in);
+
+    private:
+        FftPlan() = default;
+
+        void Transform(std::complex<double>* out, const std::complex<double>* in, int fstride, const int* factors) const;
+        void Butterfly2(std::complex<double>* out, int fstride, int m) const;
+        void Butterfly4(std::complex<double>* out, int fstride, int m) const;
+        void Butterfly5(std::complex<double>* out, int fstride, int m) const;
+        void ButterflyGeneric(std::complex<double>* out, int fstride, int m, int p) const;
+        void ExecuteBluestein(const std::complex<double>* in, std::complex<double>* out) const;
+
+        // Whether Execute can run the plan within its buffers, checked on every loaded plan
+        bool IsConsistent() const;
+
+        static const int kMaxDirectRadix = 31;
+
+        int size_ = 0;
+        bool inverse_ = false;
+
+        // Pairs (radix, remaining length) as in a decimation-in-time recursion
+        std::vector<int> factors_;
+        std::vector<std::complex<double>> twiddles_;
+
+        // Bluestein only
+        std::vector<std::complex<double>> chirp_;
+        std::vector<std::complex<double>> chirp_spectrum_;
+        std::unique_ptr<FftPlan> padded_forward_;
+        std::unique_ptr<FftPlan> padded_inverse_;
+
+};
+
+enum class FftKind {
+    kForward,
+    kInverse
+};
+
+// Plans keyed by (size, kind), shared between callers and evicted least
+// recently used first once their total size passes the memory budget.
+// Slider drags revisit the same few sizes, so planning happens once per size.
+class FftPlanCache {
+
+    public:
+        explicit FftPlanCache(size_t memory_budget_bytes = 64u << 20);
+
+        std::shared_ptr<const FftPlan> Acquire(int size, FftKind kind);
+
+        void SetMemoryBudget(size_t memory_budget_bytes);
+        size_t GetMemoryBudget() const { return memory_budget_bytes_; }
+        size_t GetMemoryUsed() const;
+        size_t GetPlanCount() const;
+
+        void Clear();
+
+        // Cache files are machine-local like the engine wisdom, doubles are stored raw
+        bool Save(const std::string& path) const;
+        bool Load(const std::string& path);
+
+    private:
+        using Key = std::uint64_t;
+
+        struct Entry {
+            std::shared_ptr<const FftPlan> plan;
+            std::list<Key>::iterator lru_position;
+        };
+
+        static Key MakeKey(int size, FftKind kind);
+        void Insert(Key key, std::shared_ptr<const FftPlan> plan);
+        void EvictToBudget();
+
+        size_t memory_budget_bytes_;
+        size_t memory_used_ = 0;
+
+        // Front is the most recently used plan
+        std::list<Key> lru_;
+        std::unordered_map<Key, Entry> entries_;
+        mutable std::mutex mutex_;
+
+};
+
+// Process-wide cache used by the coefficient engines
+FftPlanCache& DefaultPlanCache();
+
+} // namespace fourier_sim
+
+#endif  // FFT_H_
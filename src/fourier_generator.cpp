@@ -1,71 +1,406 @@
 #include "fourier_generator.h"
+#include <algorithm>
 #include <cmath>
+#include <complex>
 
 namespace fourier_sim {
 
-std::vector<sf::Vertex> Generator::GetUniversalFourier(int harmonics, int slices, std::function<float(float)> target_func, float range_start, float range_end){
+namespace {
     const float kPixelsPerUnit = 50.f;
-    const float kPi = 3.1415926535f;
-    const float kUnit = 1.0f / kPixelsPerUnit;
 
-    const float T = range_end - range_start;
-    const float L = T / 2.0f;
+    // Streaming never goes below this many harmonics per block, however small the budget
+    const int kMinStreamBlock = 256;
 
-    const float kDeltaX = T / static_cast<float>(slices);
+    // Index, result, and the even/odd sums a closed rule keeps per harmonic in a block
+    const int kStreamCopies = 3;
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
 
-    std::vector<float> an(harmonics + 1, 0.f);
-    std::vector<float> bn(harmonics + 1, 0.f);
+    // First block of the auto mode, later blocks double up to the largest
+    const int kAutoFirstBlock = 16;
+    const int kAutoMaxBlock = 1 << 16;
 
-    all_harmonics_.clear();
+    // Simpson panels for the energy of a waveform, jumps cost it about 1e-5 of the energy
+    const int kWaveformEnergyPanels = 1 << 16;
+} // namespace
+
+template <typename T>
+void BasicGenerator<T>::SampleTarget(int slices, Function target_func, T range_start, T range_end) {
+    SampleWith(slices, target_func, range_start, range_end);
+}
+
+template <typename T>
+bool BasicGenerator<T>::PrepareSamples(int slices, T range_start, T range_end) {
+    const int count = QuadratureSampleCount(rule_, slices);
+    if (samples_valid_ && sample_count_ == count && range_start_ == range_start && range_end_ == range_end) {
+        return false;
+    }
+
+    // The waveform energy belongs to the old range too
+    waveform_energy_valid_ = waveform_energy_valid_ && range_start_ == range_start && range_end_ == range_end;
+
+    samples_.resize(count);
+    sample_count_ = count;
+    range_start_ = range_start;
+    range_end_ = range_end;
+    return true;
+}
+
+template <typename T>
+void BasicGenerator<T>::FinishSamples(const Function& target_func) {
+    // Breakpoint search reuses the fresh grid and only evaluates around jumps
+    if (rule_ == QuadratureRule::kPiecewise) {
+        piecewise_.Build(target_func, samples_, range_start_, range_end_);
+    }
+    sample_energy_ = SignalEnergy(rule_, samples_);
+    samples_valid_ = true;
+}
+
+template <typename T>
+void BasicGenerator<T>::SampleAdaptive(int slices, const Function& target_func, T range_start, T range_end) {
+    // A larger budget continues the current grid, a smaller one starts over so it is respected
+    const int budget = std::max(slices, 0) + 1;
+    bool reusable = adaptive_valid_ && adaptive_.GetRangeStart() == range_start && 
+                    adaptive_.GetRangeEnd() == range_end && adaptive_.GetReport().evaluations <= budget;
+    if (!reusable) {
+        adaptive_.Reset(range_start, range_end);
+    }
+
+    adaptive_.Refine(target_func, adaptive_tolerance_, budget);
 
+    waveform_energy_valid_ = waveform_energy_valid_ && range_start_ == range_start && range_end_ == range_end;
+    range_start_ = range_start;
+    range_end_ = range_end;
+    adaptive_valid_ = true;
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::GetUniversalFourier(int harmonics, int slices, Function target_func, T range_start, T range_end){
+    ForgetSamples();
+    SampleWith(slices, target_func, range_start, range_end);
+    return BuildFromSamples(AllIndices(harmonics));
+} 
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::GetSelectedFourier(const std::vector<int>& indices, int slices, Function target_func, T range_start, T range_end) {
+    ForgetSamples();
+    SampleWith(slices, target_func, range_start, range_end);
+    return BuildFromSamples(indices);
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::GetAutoFourier(double tolerance, int max_harmonics, int slices, Function target_func, T range_start, T range_end) {
+    ForgetSamples();
+    SampleWith(slices, target_func, range_start, range_end);
+    return BuildFromSamplesToTolerance(tolerance, max_harmonics);
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::GetAutoWaveformFourier(double tolerance, int max_harmonics, const Waveform& waveform, T range_start, T range_end) {
+    SetWaveformRange(range_start, range_end);
+
+    auto source = [&waveform, range_start, range_end](const std::vector<int>& indices) {
+        return waveform.Coefficients(range_start, range_end, indices);
+    };
+    return BuildToTolerance(tolerance, max_harmonics, source, WaveformEnergy(waveform));
+}
+
+template <typename T>
+std::vector<int> BasicGenerator<T>::AllIndices(int harmonics) {
+    std::vector<int> indices(std::max(harmonics + 1, 0));
     for (int n = 0; n <= harmonics; ++n){
-        float sum_a = 0.f;
-        float sum_b = 0.f;
-        for (int i = 0; i < slices; ++i){
-            float x_math = range_start + i * kDeltaX;
-            float f_x = target_func(x_math);
-
-            float angle = n * kPi * x_math / L;
-            sum_a += f_x * std::cos(angle) * kDeltaX;
-            sum_b += f_x * std::sin(angle) * kDeltaX;
+        indices[n] = n;
+    }
+    return indices;
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::BuildFromSamples(const std::vector<int>& indices) {
+    return BuildSeries(GetSelectedHarmonics(indices), SampledEnergy(), AliasingSampleCount());
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::BuildFromSamplesToTolerance(double tolerance, int max_harmonics) {
+    // Past half the grid a sum only repeats earlier harmonics
+    const int samples = AliasingSampleCount();
+    const int limit = (samples > 0) ? std::min(max_harmonics, samples / 2) : max_harmonics;
+
+    auto source = [this](const std::vector<int>& indices) { return GetSelectedHarmonics(indices); };
+    return BuildToTolerance(tolerance, limit, source, SampledEnergy(), samples);
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::BuildToTolerance(double tolerance, int max_harmonics, const CoefficientSource& source, 
+                                                             double signal_energy, int periodic_samples) {
+    auto_report_ = AutoReport();
+
+    ParsevalTracker<T> tracker;
+    tracker.Reset(signal_energy, periodic_samples);
+
+    std::vector<HarmonicCoefficient<T>> kept;
+    std::vector<int> indices;
+    int n0 = 0;
+    int block = kAutoFirstBlock;
+    while (n0 <= max_harmonics && (kept.empty() || !tracker.Meets(tolerance))) {
+        indices.resize(std::min(block, max_harmonics + 1 - n0));
+        for (size_t k = 0; k < indices.size(); ++k) {
+            indices[k] = n0 + static_cast<int>(k);
+        }
+
+        const std::vector<HarmonicCoefficient<T>> coefficients = source(indices);
+        auto_report_.computed += static_cast<int>(coefficients.size());
+        ++auto_report_.blocks;
+
+        // a_0 is always kept, so the series is never empty
+        size_t first = 0;
+        if (kept.empty() && !coefficients.empty()) {
+            tracker.Add(coefficients.front());
+            first = 1;
+        }
+        const size_t used = first + tracker.AddUntil(coefficients, tolerance, first);
+        kept.insert(kept.end(), coefficients.begin(), coefficients.begin() + used);
+
+        n0 += static_cast<int>(indices.size());
+        block = std::min(block * 2, kAutoMaxBlock);
+    }
+
+    auto_report_.converged = tracker.Meets(tolerance);
+    auto_report_.harmonics = kept.empty() ? -1 : kept.back().index;
+    return BuildSeries(std::move(kept), signal_energy, periodic_samples);
+}
+
+template <typename T>
+double BasicGenerator<T>::SampledEnergy() const {
+    return IsAdaptive() ? adaptive_.SignalEnergy() : sample_energy_;
+}
+
+template <typename T>
+int BasicGenerator<T>::AliasingSampleCount() const {
+    // Riemann and Simpson coefficients are trig sums over the periodic grid, Filon and the
+    // adaptive panels integrate an interpolant and do not alias
+    if (IsAdaptive()) {
+        return 0;
+    }
+    if (rule_ == QuadratureRule::kRiemann) {
+        return sample_count_;
+    }
+    return (rule_ == QuadratureRule::kSimpson) ? sample_count_ - 1 : 0;
+}
+
+template <typename T>
+double BasicGenerator<T>::WaveformEnergy(const Waveform& waveform) {
+    if (waveform_energy_valid_) {
+        return waveform_energy_;
+    }
+
+    // Per-term closed forms would need every cross term, one fine Simpson pass is enough
+    std::vector<double> values(kWaveformEnergyPanels + 1);
+    const double start = static_cast<double>(range_start_);
+    const double step = (static_cast<double>(range_end_) - start) / kWaveformEnergyPanels;
+    for (int i = 0; i <= kWaveformEnergyPanels; ++i) {
+        values[i] = waveform.Evaluate(start + i * step);
+    }
+
+    waveform_energy_ = SignalEnergy(QuadratureRule::kSimpson, values);
+    waveform_energy_valid_ = true;
+    return waveform_energy_;
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::BuildSeries(std::vector<HarmonicCoefficient<T>> coefficients, double signal_energy, int periodic_samples) {
+    parseval_.Reset(signal_energy, periodic_samples);
+    for (const HarmonicCoefficient<T>& coefficient : coefficients) {
+        parseval_.Add(coefficient);
+    }
+
+    series_ = std::make_shared<const Series<T>>(std::move(coefficients), range_start_, range_end_);
+    harmonics_valid_ = false;
+
+    const T kUnit = T(1) / static_cast<T>(kPixelsPerUnit);
+    return BuildVertices(series_->EvaluateGrid(range_start_, kUnit, VertexCount()));
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::StreamFromSamples(int harmonics, size_t memory_budget_bytes, const CoefficientSink& sink) {
+    series_.reset();
+    harmonics_valid_ = false;
+    all_harmonics_.clear();
+    all_harmonics_.shrink_to_fit();
+
+    const T kUnit = T(1) / static_cast<T>(kPixelsPerUnit);
+    const int count = VertexCount();
+    GridSynthesizer<T> synthesizer(range_start_, range_end_, range_start_, kUnit, count);
+
+    // Samples, the curve with its vertices, and FFT engine scratch are there for any block size
+    const size_t fixed_bytes = samples_.capacity() * sizeof(T) + synthesizer.MemoryBytes() + count * sizeof(sf::Vertex) + 
+                               2 * samples_.size() * (sizeof(T) + sizeof(std::complex<double>));
+    const size_t harmonic_bytes = sizeof(int) + kStreamCopies * sizeof(HarmonicCoefficient<T>);
+
+    const int total = std::max(harmonics + 1, 0);
+    const size_t affordable = (memory_budget_bytes > fixed_bytes) ? (memory_budget_bytes - fixed_bytes) / harmonic_bytes : 0;
+    const int block = static_cast<int>(std::max<size_t>(std::min<size_t>(affordable, std::max(total, 1)), kMinStreamBlock));
+
+    stream_report_ = StreamReport();
+    stream_report_.block_harmonics = block;
+    stream_report_.budget_bytes = memory_budget_bytes;
+    stream_report_.estimated_peak_bytes = fixed_bytes + static_cast<size_t>(block) * harmonic_bytes;
+
+    parseval_.Reset(SampledEnergy(), AliasingSampleCount());
+
+    std::vector<int> indices;
+    indices.reserve(block);
+    for (int n0 = 0; n0 < total; n0 += block) {
+        indices.resize(std::min(block, total - n0));
+        for (size_t k = 0; k < indices.size(); ++k) {
+            indices[k] = n0 + static_cast<int>(k);
         }
-        an[n] = sum_a / L;
-        bn[n] = sum_b / L;
-
-        // Store individual harmonic functions
-        float val_an = an[n];
-        float val_bn = bn[n];
-
-        if (n == 0) {
-            all_harmonics_.push_back([val_an](float x) { 
-                return val_an / 2.0f; 
-            });
-        } else {
-            all_harmonics_.push_back([val_an, val_bn, n, kPi, L](float x) {
-                float angle = n * kPi * x / L;
-                return val_an * std::cos(angle) + val_bn * std::sin(angle);
-            });
+
+        const std::vector<HarmonicCoefficient<T>> coefficients = GetSelectedHarmonics(indices);
+        if (sink) {
+            sink(coefficients);
+        }
+        for (const HarmonicCoefficient<T>& coefficient : coefficients) {
+            parseval_.Add(coefficient);
         }
+        synthesizer.Add(coefficients);
+        ++stream_report_.blocks;
+    }
+
+    return BuildVertices(synthesizer.Result());
+}
+
+template <typename T>
+void BasicGenerator<T>::SetWaveformRange(T range_start, T range_end) {
+    // The cached samples belong to the old range
+    if (range_start != range_start_ || range_end != range_end_) {
+        samples_valid_ = false;
+        waveform_energy_valid_ = false;
+    }
+    range_start_ = range_start;
+    range_end_ = range_end;
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::GetWaveformFourier(int harmonics, const Waveform& waveform, T range_start, T range_end) {
+    return GetSelectedWaveformFourier(AllIndices(harmonics), waveform, range_start, range_end);
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::GetSelectedWaveformFourier(const std::vector<int>& indices, const Waveform& waveform, T range_start, T range_end) {
+    SetWaveformRange(range_start, range_end);
+
+    return BuildSeries(waveform.Coefficients(range_start, range_end, indices), WaveformEnergy(waveform));
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> BasicGenerator<T>::GetSelectedHarmonics(const std::vector<int>& indices) {
+    if (IsAdaptive()) {
+        return adaptive_.Coefficients(indices);
     }
 
-    std::vector<sf::Vertex> vertices;
-    for (float x_math = range_start; x_math <= range_end; x_math += kUnit){
-        float y_fourier = 0.0f;
-        for (const auto& harmonic_func : all_harmonics_) {
-            y_fourier += harmonic_func(x_math);
+    last_engine_ = ResolveEngine(static_cast<int>(indices.size()));
+    if (rule_ == QuadratureRule::kPiecewise) {
+        return piecewise_.Coefficients(last_engine_, indices, summation_);
+    }
+    return IntegrateCoefficients(rule_, last_engine_, samples_, range_start_, range_end_, indices, summation_);
+}
+
+template <typename T>
+SummationReport BasicGenerator<T>::MeasureSummationError(SummationMode mode, const std::vector<int>& indices) const {
+    // The left-sum grid is the cached grid without a closed rule's endpoint
+    size_t count = samples_.size();
+    if (rule_ != QuadratureRule::kRiemann && count > 0) {
+        --count;
+    }
+    std::vector<T> riemann_samples(samples_.begin(), samples_.begin() + count);
+    return fourier_sim::MeasureSummationError(mode, riemann_samples, range_start_, range_end_, indices);
+}
+
+template <typename T>
+EngineKind BasicGenerator<T>::ResolveEngine(int harmonic_count) {
+    if (engine_ != EngineKind::kAuto) {
+        return engine_;
+    }
+    if (summation_ != SummationMode::kNaive) {
+        return EngineKind::kDirect;
+    }
+    return tuner_.Select(harmonic_count, static_cast<int>(samples_.size()));
+}
+
+template <typename T>
+const std::vector<typename BasicGenerator<T>::Function>& BasicGenerator<T>::GetHarmonics() const {
+    if (harmonics_valid_) {
+        return all_harmonics_;
+    }
+
+    // Half period of the series, range_ may already belong to the next sampling
+    all_harmonics_.clear();
+    if (series_) {
+        const T L = (series_->GetRangeEnd() - series_->GetRangeStart()) / T(2);
+        all_harmonics_.reserve(series_->GetCoefficients().size());
+        for (const HarmonicCoefficient<T>& c : series_->GetCoefficients()) {
+            AddHarmonicFunction(c.index, c.a, c.b, L);
         }
+    }
+    harmonics_valid_ = true;
+    return all_harmonics_;
+}
 
-        float x_pixels = x_math * kPixelsPerUnit;
-        float y_pixels = y_fourier * kPixelsPerUnit;
+template <typename T>
+int BasicGenerator<T>::CoefficientsForError(double tolerance) const {
+    if (!series_) {
+        return -1;
+    }
+
+    ParsevalTracker<T> tracker = parseval_;
+    tracker.Clear();
+    const size_t count = tracker.AddUntil(series_->GetCoefficients(), tolerance);
+    return tracker.Meets(tolerance) ? static_cast<int>(count) : -1;
+}
+
+template <typename T>
+void BasicGenerator<T>::AddHarmonicFunction(int n, T an, T bn, T L) const {
+    const T kPi = static_cast<T>(kPiLong);
+
+    if (n == 0) {
+        all_harmonics_.push_back([an](T x) { 
+            return an / T(2); 
+        });
+    } else {
+        all_harmonics_.push_back([an, bn, n, kPi, L](T x) {
+            T angle = n * kPi * x / L;
+            return an * std::cos(angle) + bn * std::sin(angle);
+        });
+    }
+}
 
-        sf::Vertex point;
-        point.position = {x_pixels, y_pixels};
-        point.color = sf::Color::Yellow;
-        vertices.push_back(point);
+template <typename T>
+int BasicGenerator<T>::VertexCount() const {
+    // Index-based grid, x_math += kUnit used to drift and drop or add the last point
+    const T span = (range_end_ - range_start_) * static_cast<T>(kPixelsPerUnit);
+    return (span >= T(0)) ? static_cast<int>(std::floor(span + static_cast<T>(1e-3))) + 1 : 0;
+}
+
+template <typename T>
+std::vector<sf::Vertex> BasicGenerator<T>::BuildVertices(const std::vector<T>& y_fourier) const {
+    const T kUnit = T(1) / static_cast<T>(kPixelsPerUnit);
+    const int count = static_cast<int>(y_fourier.size());
+
+    std::vector<sf::Vertex> vertices(count);
+    for (int j = 0; j < count; ++j) {
+        T x_math = range_start_ + j * kUnit;
+
+        float x_pixels = static_cast<float>(x_math) * kPixelsPerUnit;
+        float y_pixels = static_cast<float>(y_fourier[j]) * kPixelsPerUnit;
+
+        vertices[j].position = {x_pixels, y_pixels};
+        vertices[j].color = sf::Color::Yellow;
     }
 
     return vertices;
+}
 
-} 
+template class BasicGenerator<float>;
+template class BasicGenerator<double>;
+template class BasicGenerator<long double>;
 
-} // namespace fourier_sim
\ No newline at end of file
+} // namespace fourier_sim
@@ -4,22 +4,261 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <string>
+#include "adaptive_sampler.h"
+#include "coefficient_engine.h"
+#include "convergence.h"
+#include "engine_tuner.h"
+#include "piecewise_integrator.h"
+#include "quadrature.h"
+#include "series.h"
+#include "waveform.h"
 
 namespace fourier_sim {
 
-class Generator {
+struct StreamReport {
+    int blocks = 0;
+    int block_harmonics = 0;
+    // Budget the block size was derived from and what the stream is estimated to hold at most
+    size_t budget_bytes = 0;
+    size_t estimated_peak_bytes = 0;
+};
+
+struct AutoReport {
+    int harmonics = -1;     // Highest index kept
+    int computed = 0;       // Coefficients computed, including those past the stop
+    int blocks = 0;
+    bool converged = false; // False when the harmonic limit was reached first
+};
+
+// Scalar type is chosen per job: float for the interactive view, double or
+// long double for batch accuracy. Instantiated in fourier_generator.cpp.
+template <typename T>
+class BasicGenerator {
 
     public:
-        std::vector<sf::Vertex> GetUniversalFourier(int harmonics, int slices, std::function<float(float)> target_func, float range_start = 0.0f, float range_end = 16.0f);
+        using Function = std::function<T(T)>;
+
+        std::vector<sf::Vertex> GetUniversalFourier(int harmonics, int slices, Function target_func, T range_start = T(0), T range_end = T(16));
+
+        // Builds the series from a hand-picked subset of harmonics only
+        std::vector<sf::Vertex> GetSelectedFourier(const std::vector<int>& indices, int slices, Function target_func, T range_start = T(0), T range_end = T(16));
+
+        // Closed-form coefficients of a recognized waveform (see ParseWaveform), nothing is sampled
+        std::vector<sf::Vertex> GetWaveformFourier(int harmonics, const Waveform& waveform, T range_start = T(0), T range_end = T(16));
+        std::vector<sf::Vertex> GetSelectedWaveformFourier(const std::vector<int>& indices, const Waveform& waveform, T range_start = T(0), T range_end = T(16));
+
+        // Entry points that take a function always resample it. SampleTarget instead keeps the
+        // cache while the sample count, range and rule are unchanged, and the GetSampled*
+        // calls build from whatever it last sampled, e.g. when only the harmonics change.
+        void SampleTarget(int slices, Function target_func, T range_start, T range_end);
+        std::vector<sf::Vertex> GetSampledFourier(int harmonics) { return BuildFromSamples(AllIndices(harmonics)); }
+        std::vector<sf::Vertex> GetSelectedSampledFourier(const std::vector<int>& indices) { return BuildFromSamples(indices); }
+        std::vector<sf::Vertex> GetAutoSampledFourier(double tolerance, int max_harmonics) { 
+            return BuildFromSamplesToTolerance(tolerance, max_harmonics); 
+        }
+
+        // Same entry points for any callable T(T). Lambdas and functors such as SquareShape
+        // get an inlined sampling loop, std::function arguments take the overloads above.
+        // The cache cannot tell two callables apart, so these resample on every call too.
+        template <typename F>
+        std::vector<sf::Vertex> GetUniversalFourier(int harmonics, int slices, const F& target_func, T range_start = T(0), T range_end = T(16)) {
+            ForgetSamples();
+            SampleWith(slices, target_func, range_start, range_end);
+            return BuildFromSamples(AllIndices(harmonics));
+        }
+
+        template <typename F>
+        std::vector<sf::Vertex> GetSelectedFourier(const std::vector<int>& indices, int slices, const F& target_func, T range_start = T(0), T range_end = T(16)) {
+            ForgetSamples();
+            SampleWith(slices, target_func, range_start, range_end);
+            return BuildFromSamples(indices);
+        }
 
-        const std::vector<std::function<float(float)>>& GetHarmonics() const { 
-            return all_harmonics_; 
+        template <typename F>
+        void SampleTarget(int slices, const F& target_func, T range_start, T range_end) {
+            SampleWith(slices, target_func, range_start, range_end);
         }
 
+        // Fewest harmonics whose mean-square error (see GetConvergenceReport) is at most
+        // tolerance, up to max_harmonics. Coefficients are computed in blocks that double
+        // in size and each one is checked by Parseval as it arrives, so at most about twice
+        // the harmonics needed are computed and none is evaluated on the grid. Sample sums
+        // alias past half their grid, there the limit is also half the sample count.
+        template <typename F>
+        std::vector<sf::Vertex> GetAutoFourier(double tolerance, int max_harmonics, int slices, const F& target_func, T range_start = T(0), T range_end = T(16)) {
+            ForgetSamples();
+            SampleWith(slices, target_func, range_start, range_end);
+            return BuildFromSamplesToTolerance(tolerance, max_harmonics);
+        }
+        std::vector<sf::Vertex> GetAutoFourier(double tolerance, int max_harmonics, int slices, Function target_func, T range_start = T(0), T range_end = T(16));
+        std::vector<sf::Vertex> GetAutoWaveformFourier(double tolerance, int max_harmonics, const Waveform& waveform, T range_start = T(0), T range_end = T(16));
+        const AutoReport& GetAutoReport() const { return auto_report_; }
+
+        // Memory-bounded variant for very long series, e.g. 10^7 harmonics in a headless job.
+        // Coefficients are produced in index blocks sized to the budget, handed to sink
+        // (may be empty) and summed onto the curve in place. Neither the series nor the
+        // per-harmonic functions are kept, GetSeries() and GetHarmonics() come back empty.
+        // The sample grid and the curve count against the budget but are always allocated.
+        using CoefficientSink = std::function<void(const std::vector<HarmonicCoefficient<T>>&)>;
+
+        template <typename F>
+        std::vector<sf::Vertex> StreamUniversalFourier(int harmonics, int slices, const F& target_func, size_t memory_budget_bytes, 
+                                                       const CoefficientSink& sink = CoefficientSink(), T range_start = T(0), T range_end = T(16)) {
+            ForgetSamples();
+            SampleWith(slices, target_func, range_start, range_end);
+            return StreamFromSamples(harmonics, memory_budget_bytes, sink);
+        }
+        const StreamReport& GetStreamReport() const { return stream_report_; }
+
+        // Must be called before SampleTarget when the target function changes
+        void InvalidateSamples() { 
+            ForgetSamples();
+            waveform_energy_valid_ = false;
+        }
+
+        // Coefficients for arbitrary indices over the cached samples (Goertzel for sparse sets under kAuto)
+        std::vector<HarmonicCoefficient<T>> GetSelectedHarmonics(const std::vector<int>& indices);
+
+        // kAuto dispatches every request to the engine the tuner rates fastest for its shape
+        void SetEngine(EngineKind engine) { engine_ = engine; }
+
+        // kAuto's crossovers: a static estimate until wisdom for this scalar type is loaded
+        // or TuneEngines() measures it, which blocks for a few hundred milliseconds
+        bool LoadEngineWisdom(const std::string& path) { return tuner_.Load(path); }
+        bool SaveEngineWisdom(const std::string& path) const { return tuner_.Save(path); }
+        void TuneEngines() { tuner_.Tune(); }
+        bool AreEnginesTuned() const { return tuner_.IsTuned(); }
+        EngineKind GetEngine() const { return engine_; }
+        EngineKind GetLastEngine() const { return last_engine_; }
+
+        // Compensated modes only apply to the direct kernel, so they make kAuto resolve to kDirect
+        void SetSummationMode(SummationMode mode) { summation_ = mode; }
+        SummationMode GetSummationMode() const { return summation_; }
+
+        // Measured error of each summation mode for the given indices over the cached samples
+        SummationReport MeasureSummationError(SummationMode mode, const std::vector<int>& indices) const;
+
+        // Closed rules sample the right endpoint and round slices up to an even panel count
+        void SetQuadratureRule(QuadratureRule rule) { 
+            samples_valid_ = samples_valid_ && rule == rule_;
+            rule_ = rule; 
+        }
+        QuadratureRule GetQuadratureRule() const { return rule_; }
+
+        // Jumps and kinks the last piecewise sampling split the range at
+        const std::vector<Breakpoint>& GetBreakpoints() const { return piecewise_.GetBreakpoints(); }
+
+        // The series behind the last curve, null before the first build; evaluates at any
+        // point set, e.g. a short preview or a multi-million point export
+        std::shared_ptr<const Series<T>> GetSeries() const { return series_; }
+
+        // One function per coefficient of GetSeries(), built on first use. Views that only
+        // need the coefficients read them from the series and never pay for these.
+        const std::vector<Function>& GetHarmonics() const;
+
+        // Mean-square error of the last series against the target by Parseval: the energy
+        // of the samples (or of the waveform) minus that of the coefficients, tracked as
+        // they are built. Streaming fills it in block by block without keeping the series.
+        // Riemann and Simpson indices past half the grid alias and mark it unreliable.
+        ConvergenceReport GetConvergenceReport() const { return parseval_.GetReport(); }
+
+        // Fewest leading coefficients of GetSeries() whose error is at most tolerance, -1 when
+        // the whole series misses it. O(1) per coefficient, no coefficient is recomputed.
+        int CoefficientsForError(double tolerance) const;
+
+        // A positive tolerance switches to adaptive sampling: slices becomes the upper
+        // bound on evaluations (at least 5) and the grid stops refining once the estimate meets it
+        void SetAdaptiveTolerance(T tolerance) { adaptive_tolerance_ = tolerance; }
+        bool IsAdaptive() const { return adaptive_tolerance_ > T(0); }
+        const AdaptiveReport& GetAdaptiveReport() const { return adaptive_.GetReport(); }
+
     private:
-        std::vector<std::function<float(float)>> all_harmonics_;
+        template <typename F>
+        void SampleWith(int slices, const F& target_func, T range_start, T range_end) {
+            if (IsAdaptive()) {
+                SampleAdaptive(slices, Function(target_func), range_start, range_end);
+                return;
+            }
+            if (!PrepareSamples(slices, range_start, range_end)) {
+                return;
+            }
+
+            // Closed rules add the right endpoint, spacing stays T / panels
+            const int count = sample_count_;
+            const int panels = (rule_ == QuadratureRule::kRiemann) ? count : count - 1;
+            const T kDeltaX = (range_end - range_start) / static_cast<T>(panels);
+
+            T* samples = samples_.data();
+            for (int i = 0; i < count; ++i) {
+                samples[i] = target_func(range_start + i * kDeltaX);
+            }
+
+            FinishSamples(Function(target_func));
+        }
+
+        void ForgetSamples() {
+            samples_valid_ = false;
+            adaptive_valid_ = false;
+        }
+
+        // Sizes the sample buffer, false while the cached grid still matches
+        bool PrepareSamples(int slices, T range_start, T range_end);
+        void FinishSamples(const Function& target_func);
+
+        static std::vector<int> AllIndices(int harmonics);
+        std::vector<sf::Vertex> BuildFromSamples(const std::vector<int>& indices);
+        std::vector<sf::Vertex> BuildFromSamplesToTolerance(double tolerance, int max_harmonics);
+        std::vector<sf::Vertex> StreamFromSamples(int harmonics, size_t memory_budget_bytes, const CoefficientSink& sink);
+
+        void SampleAdaptive(int slices, const Function& target_func, T range_start, T range_end);
+        void SetWaveformRange(T range_start, T range_end);
+        EngineKind ResolveEngine(int harmonic_count);
+        void AddHarmonicFunction(int n, T an, T bn, T L) const;
+        double SampledEnergy() const;
+        int AliasingSampleCount() const;
+        double WaveformEnergy(const Waveform& waveform);
+        std::vector<sf::Vertex> BuildSeries(std::vector<HarmonicCoefficient<T>> coefficients, double signal_energy, int periodic_samples = 0);
+
+        using CoefficientSource = std::function<std::vector<HarmonicCoefficient<T>>(const std::vector<int>&)>;
+        std::vector<sf::Vertex> BuildToTolerance(double tolerance, int max_harmonics, const CoefficientSource& source, 
+                                                 double signal_energy, int periodic_samples = 0);
+        int VertexCount() const;
+        std::vector<sf::Vertex> BuildVertices(const std::vector<T>& y_fourier) const;
+
+        // Cache of GetHarmonics(), stale whenever series_ changes
+        mutable std::vector<Function> all_harmonics_;
+        mutable bool harmonics_valid_ = false;
+        std::shared_ptr<const Series<T>> series_;
+        StreamReport stream_report_;
+        AutoReport auto_report_;
+        ParsevalTracker<T> parseval_;
+
+        std::vector<T> samples_;
+        bool samples_valid_ = false;
+        int sample_count_ = 0;
+        double sample_energy_ = 0.0;
+        double waveform_energy_ = 0.0;
+        bool waveform_energy_valid_ = false;
+        T range_start_ = T(0);
+        T range_end_ = T(16);
+
+        EngineKind engine_ = EngineKind::kAuto;
+        EngineKind last_engine_ = EngineKind::kDirect;
+        SummationMode summation_ = SummationMode::kNaive;
+        QuadratureRule rule_ = QuadratureRule::kRiemann;
+        PiecewiseIntegrator<T> piecewise_;
+
+        AdaptiveSampler<T> adaptive_;
+        T adaptive_tolerance_ = T(0);
+        bool adaptive_valid_ = false;
+        EngineTuner tuner_{ScalarKindOf<T>()};
 
 };
+
+using Generator = BasicGenerator<float>;
+
 } // namespace fourier_sim
 
-#endif  // FOURIER_GENERATOR_H_
\ No newline at end of file
+#endif  // FOURIER_GENERATOR_H_
@@ -0,0 +1,122 @@
+#include "frame_composer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ui {
+
+namespace {
+    // Past this many separate regions one enclosing region is cheaper than the draw calls
+    const size_t kMaxRegions = 8;
+
+    sf::FloatRect Enclose(const sf::FloatRect& a, const sf::FloatRect& b) {
+        const float left = std::min(a.position.x, b.position.x);
+        const float top = std::min(a.position.y, b.position.y);
+        const float right = std::max(a.position.x + a.size.x, b.position.x + b.size.x);
+        const float bottom = std::max(a.position.y + a.size.y, b.position.y + b.size.y);
+        return sf::FloatRect({left, top}, {right - left, bottom - top});
+    }
+} // namespace
+
+FrameComposer::FrameComposer(const sf::View& view) : view_(view) {}
+
+bool FrameComposer::Resize(sf::Vector2u size) {
+    if (!backbuffer_.resize(size)) {
+        return false;
+    }
+    InvalidateAll();
+    return true;
+}
+
+void FrameComposer::Invalidate(sf::FloatRect region) {
+    if (!(region.size.x > 0.f) || !(region.size.y > 0.f)) {
+        return;
+    }
+
+    // Overlapping regions are merged, a merge may reach regions the first one missed
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (auto it = dirty_.begin(); it != dirty_.end(); ++it) {
+            if (it->findIntersection(region)) {
+                region = Enclose(region, *it);
+                dirty_.erase(it);
+                merged = true;
+                break;
+            }
+        }
+    }
+    dirty_.push_back(region);
+
+    if (dirty_.size() > kMaxRegions) {
+        sf::FloatRect all = dirty_.front();
+        for (const sf::FloatRect& other : dirty_) {
+            all = Enclose(all, other);
+        }
+        dirty_.assign(1, all);
+    }
+}
+
+void FrameComposer::InvalidateAll() {
+    // The view's visible rectangle, sizes may be negative for a flipped axis
+    const sf::Vector2f center = view_.getCenter();
+    const sf::Vector2f half = {std::abs(view_.getSize().x) / 2.f, std::abs(view_.getSize().y) / 2.f};
+    dirty_.assign(1, sf::FloatRect(center - half, half * 2.f));
+}
+
+void FrameComposer::Compose(const Painter& painter) {
+    if (dirty_.empty()) {
+        return;
+    }
+
+    float share = 0.f;
+    for (const sf::FloatRect& region : dirty_) {
+        const sf::FloatRect scissor = ToScissor(region);
+        if (!(scissor.size.x > 0.f) || !(scissor.size.y > 0.f)) {
+            continue;
+        }
+        share += scissor.size.x * scissor.size.y;
+
+        sf::View clipped = view_;
+        clipped.setScissor(scissor);
+        backbuffer_.setView(clipped);
+        painter(backbuffer_, region);
+    }
+
+    backbuffer_.setView(view_);
+    backbuffer_.display();
+    dirty_.clear();
+    last_repainted_share_ = std::min(share, 1.f);
+}
+
+void FrameComposer::Present(sf::RenderTarget& target) const {
+    const sf::View previous = target.getView();
+    target.setView(target.getDefaultView());
+    target.draw(sf::Sprite(backbuffer_.getTexture()));
+    target.setView(previous);
+}
+
+sf::View FrameComposer::WithScissor(sf::View view, const sf::RenderTarget& target) {
+    view.setScissor(target.getView().getScissor());
+    return view;
+}
+
+sf::FloatRect FrameComposer::ToScissor(const sf::FloatRect& region) const {
+    // Region corners through the view to [-1, 1], then to target fractions with y down
+    const sf::Transform& transform = view_.getTransform();
+    const sf::Vector2f a = transform.transformPoint(region.position);
+    const sf::Vector2f b = transform.transformPoint(region.position + region.size);
+
+    // Widened to whole pixels plus one, antialiased edges of the widgets stay inside
+    const sf::Vector2f size = {static_cast<float>(backbuffer_.getSize().x), static_cast<float>(backbuffer_.getSize().y)};
+    if (!(size.x > 0.f) || !(size.y > 0.f)) {
+        return sf::FloatRect();
+    }
+    const float left = std::clamp(std::floor((std::min(a.x, b.x) + 1.f) / 2.f * size.x) - 1.f, 0.f, size.x);
+    const float right = std::clamp(std::ceil((std::max(a.x, b.x) + 1.f) / 2.f * size.x) + 1.f, 0.f, size.x);
+    const float top = std::clamp(std::floor((1.f - std::max(a.y, b.y)) / 2.f * size.y) - 1.f, 0.f, size.y);
+    const float bottom = std::clamp(std::ceil((1.f - std::min(a.y, b.y)) / 2.f * size.y) + 1.f, 0.f, size.y);
+
+    return sf::FloatRect({left / size.x, top / size.y}, {(right - left) / size.x, (bottom - top) / size.y});
+}
+
+} // namespace ui
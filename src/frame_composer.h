@@ -0,0 +1,52 @@
+#ifndef FRAME_COMPOSER_H_
+#define FRAME_COMPOSER_H_
+
+#include <SFML/Graphics.hpp>
+#include <functional>
+#include <vector>
+
+namespace ui {
+
+// Keeps the last frame in an offscreen backbuffer and repaints only the regions
+// invalidated since, so a caret blink or a slider drag does not redraw the plot.
+// Regions are in the coordinates of the view given at construction. While painting
+// a region, the backbuffer's view carries a scissor cut to it; a painter that sets
+// another view passes it through WithScissor so nothing outside the region changes.
+class FrameComposer {
+    public:
+        using Painter = std::function<void(sf::RenderTarget& target, const sf::FloatRect& region)>;
+
+        explicit FrameComposer(const sf::View& view);
+
+        // False when the backbuffer could not be created
+        bool Resize(sf::Vector2u size);
+
+        void Invalidate(sf::FloatRect region);
+        void InvalidateAll();
+        bool HasDirty() const { return !dirty_.empty(); }
+
+        // Repaints every dirty region into the backbuffer, painter draws the whole scene
+        // and the scissor keeps it to the region
+        void Compose(const Painter& painter);
+
+        // The backbuffer stretched over target, one draw call
+        void Present(sf::RenderTarget& target) const;
+
+        // view with the scissor of the region being painted
+        static sf::View WithScissor(sf::View view, const sf::RenderTarget& target);
+
+        // Share of the window repainted by the last Compose
+        float GetLastRepaintedShare() const { return last_repainted_share_; }
+
+    private:
+        sf::FloatRect ToScissor(const sf::FloatRect& region) const;
+
+        sf::View view_;
+        sf::RenderTexture backbuffer_;
+        std::vector<sf::FloatRect> dirty_;
+        float last_repainted_share_ = 0.f;
+};
+
+} // namespace ui
+
+#endif  // FRAME_COMPOSER_H_
@@ -2,12 +2,123 @@
 #define FUNCTION_GENERATOR_H_
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <functional>
 
 namespace eq_sim {
-    std::vector<sf::Vertex> getInstance(std::function<float(float)> target_func);
+    const int kWidth = 800;
+    const int kHeight = 600;
+
+    const float kPixelsPerUnit = 50.f;
+
+    // count points spread over [x_begin, x_end] in math units, positions in plot pixels
+    // at kPixelsPerUnit. Any callable T(T): lambdas and functors such as
+    // fourier_sim::SquareShape are inlined into the sampling loop.
+    template <typename T = float, typename F>
+    std::vector<sf::Vertex> getInstance(const F& target_func, T x_begin, T x_end, int count) {
+        std::vector<sf::Vertex> vertices(std::max(count, 0));
+        const T x_step = (count > 1) ? (x_end - x_begin) / static_cast<T>(count - 1) : T(0);
+
+        for (int i = 0; i < count; ++i) {
+            T x_math = x_begin + i * x_step;
+            T y_math = target_func(x_math);
+            float x_pixels = static_cast<float>(x_math) * kPixelsPerUnit;
+            float y_pixels = static_cast<float>(y_math) * kPixelsPerUnit;
+
+            vertices[i].position = {x_pixels, y_pixels};
+            vertices[i].color = sf::Color::Green;
+        }
+
+        return vertices;
+    }
+
+    // Adaptive counterpart of the ranged getInstance. Starts from segments of
+    // kAdaptiveSegmentPixels screen pixels and halves a segment while its midpoint lies more
+    // than tolerance screen pixels off the chord, down to kAdaptiveMinPixels. Straight
+    // stretches keep a handful of vertices, fast oscillation such as sin(x*x) at large x
+    // gets sub-pixel ones. column_width is world units (plot pixels at kPixelsPerUnit)
+    // per screen pixel, 1 at the default zoom.
+    const float kAdaptiveSegmentPixels = 4.f;
+    const float kAdaptiveSteepPixels = 32.f;
+    const float kAdaptiveMinPixels = 0.25f;
+    const int kAdaptiveMaxVertices = 1 << 16;
+
+    template <typename T = float, typename F>
+    std::vector<sf::Vertex> getAdaptiveInstance(const F& target_func, T x_begin, T x_end, float column_width = 1.f, float tolerance = 0.5f) {
+        std::vector<sf::Vertex> vertices;
+        if (!(x_end > x_begin) || !(column_width > 0.f)) {
+            return vertices;
+        }
+
+        // Math units to screen pixels
+        const T to_screen = static_cast<T>(kPixelsPerUnit / column_width);
+        auto emit = [&](T x, T y) {
+            sf::Vertex vertex;
+            vertex.position = {static_cast<float>(x) * kPixelsPerUnit, static_cast<float>(y) * kPixelsPerUnit};
+            vertex.color = sf::Color::Green;
+            vertices.push_back(vertex);
+        };
+
+        struct Segment {
+            T a, fa, b, fb;
+        };
+        std::vector<Segment> pending;
+
+        const int segments = std::max(1, static_cast<int>(std::ceil((x_end - x_begin) * to_screen / kAdaptiveSegmentPixels)));
+        const T width = (x_end - x_begin) / static_cast<T>(segments);
+
+        T a = x_begin;
+        T fa = target_func(a);
+        emit(a, fa);
+        for (int k = 1; k <= segments; ++k) {
+            const T b = (k == segments) ? x_end : x_begin + k * width;
+            const T fb = target_func(b);
+
+            // Depth first, left half on top, so vertices come out in increasing x
+            pending.push_back({a, fa, b, fb});
+            while (!pending.empty()) {
+                const Segment s = pending.back();
+                pending.pop_back();
+
+                const T m = (s.a + s.b) / T(2);
+                const T fm = target_func(m);
+                const T error = std::abs(fm - (s.fa + s.fb) / T(2)) * to_screen;
+                const bool splittable = (s.b - s.a) * to_screen > T(2) * kAdaptiveMinPixels &&
+                                        static_cast<int>(vertices.size() + pending.size()) < kAdaptiveMaxVertices;
+
+                // A chord spanning kAdaptiveSteepPixels vertically may hide an oscillation the
+                // midpoint happens to miss, so it is split even when the midpoint agrees
+                const bool steep = std::abs(s.fb - s.fa) * to_screen > static_cast<T>(kAdaptiveSteepPixels);
+
+                // A NaN error also splits, so poles and domain edges get narrowed down
+                if (splittable && (!(error <= static_cast<T>(tolerance)) || steep)) {
+                    pending.push_back({m, fm, s.b, s.fb});
+                    pending.push_back({s.a, s.fa, m, fm});
+                } else {
+                    emit(m, fm);
+                    emit(s.b, s.fb);
+                }
+            }
+
+            a = b;
+            fa = fb;
+        }
+
+        return vertices;
+    }
+
+    // The default 800 pixel plot, one point per pixel column
+    template <typename T = float, typename F>
+    std::vector<sf::Vertex> getInstance(const F& target_func) {
+        return getInstance<T>(target_func, T(0), static_cast<T>(kWidth) / kPixelsPerUnit, kWidth + 1);
+    }
+
+    // Instantiated for float, double and long double in function_generator.cpp
+    template <typename T>
+    std::vector<sf::Vertex> getInstance(std::function<T(T)> target_func);
 } // namespace eq_sim
 
 
-#endif  // FUNCTION_GENERATOR_H_
\ No newline at end of file
+#endif  // FUNCTION_GENERATOR_H_
@@ -1,9 +1,16 @@
 #include <SFML/Graphics.hpp>
+#include <array>
 #include <cmath>
 #include "function_generator.h"
 #include "ui_elements.h"
+#include "static_layer.h"
+#include "frame_composer.h"
 #include "fourier_generator.h"
 #include "math_engine.h"
+#include "harmonic_selection.h"
+#include "decimation.h"
+#include "tile_cache.h"
+#include "fft.h"
 #include <algorithm>
 
 std::string round_to_string(float value, int n = 2) {
@@ -13,6 +20,24 @@ std::string round_to_string(float value, int n = 2) {
     return out.str();
 }
 
+std::string scientific_to_string(double value, int n = 1) {
+    std::ostringstream out;
+    out.precision(n);
+    out << std::scientific << value;
+    return out.str();
+}
+
+// 1, 2 or 5 times a power of ten, the first at least raw
+float nice_tick_step(float raw) {
+    const float power = std::pow(10.f, std::floor(std::log10(raw)));
+    for (float mantissa : {1.f, 2.f, 5.f}) {
+        if (mantissa * power >= raw) {
+            return mantissa * power;
+        }
+    }
+    return 10.f * power;
+}
+
 int main() {
     // Default function
     std::function<float(float)> target_func = [](float x) -> float {
@@ -32,6 +57,17 @@ int main() {
 
     const float kPixelsPerUnit = kTickSpacing;
 
+    // Plot area above the options panel
+    const float kPlotHeight = kHeight - kPanelHeight;
+
+    // Mouse wheel zooms about the cursor, dragging in the plot pans
+    const float kZoomStep = 1.25f;
+    const float kMinZoom = 1.f / 64.f;
+    const float kMaxZoom = 1024.f;
+
+    // Ranges are free within this, the generator still builds one vertex per 1/50 unit
+    const float kRangeLimit = 1000.f;
+
     // Options panel position
     const float kOptionsPanelHeight = -kPanelHeight / 2.0f - kHeight / 2.0f;
 
@@ -44,14 +80,40 @@ int main() {
     float slider_min_val = 0.0f;
     float slider_max_val = 500.0f;
 
-    // Control variable to optimize redraws
-    bool draw_last_loop = false;
 
+    // Hand-picked harmonics, empty means every harmonic up to the slider value
+    std::vector<int> selected_harmonics;
+
+    // Adaptive sampling (key A): the slices slider becomes an upper bound
+    bool adaptive_sampling = false;
+    const float kAdaptiveTolerance = 1e-3f;
+
+    // Auto harmonics (key T): the harmonics slider picks a mean-square error tolerance on a
+    // log scale and the generator finds the fewest harmonics that meet it
+    bool auto_harmonics = false;
+    const float kAutoToleranceDecades = 6.f;
+    const int kAutoMaxHarmonics = 1 << 14;
+
+    // Curves are cut to about two vertices per pixel column before drawing, key R adds RDP
+    fourier_sim::DecimationMode decimation = fourier_sim::DecimationMode::kMinMax;
+
+    // The series is periodic, outside its range it is drawn by repeating one period (key P)
+    bool periodic_extension = true;
+    // More visible periods than this are baked into one strip instead of one draw call each
+    const long long kMaxPeriodDraws = 16;
 
     // Range for Fourier series
     float range_start = 0.0f;
     float range_end = 16.0f;
 
+    // Viewport: plot pixels per world pixel and the world point at the plot center.
+    // World coordinates are math units times kPixelsPerUnit.
+    float zoom = 1.f;
+    sf::Vector2f plot_center = {kWidth / 2.f, 0.f};
+    bool panning = false;
+    sf::Vector2i pan_anchor;
+    sf::Vector2f pan_anchor_center;
+
     // Load font
     sf::Font main_font;
     if (!main_font.openFromFile("LatinmodernmathRegular-z8EBa.otf")) {
@@ -61,11 +123,24 @@ int main() {
     // Fourier generator instance
     fourier_sim::Generator fourier_sim;
 
-    // Grid and labels setup
-    sf::Text label_text(main_font);
-    label_text.setCharacterSize(15);
-    label_text.setFillColor(sf::Color::White);
-    label_text.setScale({1.0f, -1.0f});
+    // Resampled series per zoom level, finer levels fill in from a background thread
+    fourier_sim::TileCache<float> tile_cache(1.f / kPixelsPerUnit);
+    std::vector<float> tile_x;
+    std::vector<float> tile_y;
+
+    // Square and sawtooth inputs need their jumps split out to converge at low slice counts
+    fourier_sim.SetQuadratureRule(fourier_sim::QuadratureRule::kPiecewise);
+
+    // FFT plans from previous runs, so a cold start skips planning
+    const std::string kPlanCachePath = "fft_plans.bin";
+    fourier_sim::DefaultPlanCache().Load(kPlanCachePath);
+
+    // Engine crossovers measured by an earlier run (key E), a static estimate without them
+    const std::string kWisdomPath = "fourier_wisdom.txt";
+    fourier_sim.LoadEngineWisdom(kWisdomPath);
+
+    // Tick labels are baked into the axis layer, not kept as sf::Text
+    const unsigned int kLabelSize = 15;
 
     sf::Text harmonics_value(main_font); 
     ui::setupText(harmonics_value, 14, {kSliderXOffset + 10.f, kOptionsPanelHeight + 80.0f});
@@ -85,6 +160,10 @@ int main() {
     ui::setupText(range_end_text, 14, {kWidth - kSliderXOffset - 140.f, kOptionsPanelHeight + 75.0f});
     range_end_text.setString("Range End: ");
 
+    sf::Text subset_text(main_font);
+    ui::setupText(subset_text, 14, {kSliderXOffset, kOptionsPanelHeight + 25.0f});
+    subset_text.setString("Subset: ");
+
     sf::Text user_info_text(main_font);
     ui::setupText(user_info_text, 13, {kWidth - 160.f, kOptionsPanelHeight + 20.f});
     user_info_text.setString("Math engine used: ExprTk");
@@ -96,31 +175,11 @@ int main() {
     sf::RenderWindow window(sf::VideoMode({(int)kWidth, (int)kHeight}), "Fourier Simulation", sf::Style::Titlebar | sf::Style::Close);
     window.setView(view); 
 
-    // X axis line vertices
-    sf::Vertex line_start;
-    line_start.position = {0.f, 0.f};
-    line_start.color = sf::Color::White;
-
-    sf::Vertex line_end;
-    line_end.position = {static_cast<float>(kWidth), 0.f};
-    line_end.color = sf::Color::White;
-
-    std::array<sf::Vertex, 2> line_vertices = {line_start, line_end};
-
-    // Grid lines vertices
-    std::vector<sf::Vertex> grid_lines;
-    for (float x = 0.f; x<=kWidth; x += kTickSpacing){
-        sf::Vertex tickUp;
-        tickUp.position = {x, kTickSize};
-        tickUp.color = sf::Color::White;
-        grid_lines.push_back(tickUp);
-
-        sf::Vertex tickDown;
-        tickDown.position = {x, -kTickSize};
-        tickDown.color = sf::Color::White;
-        grid_lines.push_back(tickDown);
-
-    }
+    // Axis, ticks and their labels in window coordinates, rebuilt only when the viewport
+    // moves. Panel backgrounds and fixed captions never change and are baked once below.
+    ui::StaticLayer axis_layer;
+    ui::StaticLayer panel_layer;
+    bool axis_stale = true;
 
     // Create sliders and panels
     ui::Panel options_panel({0, kOptionsPanelHeight}, {kWidth, kPanelHeight});
@@ -136,58 +195,327 @@ int main() {
     ui::TextBox max_value_input_box({kWidth - kSliderXOffset - 50.f, kOptionsPanelHeight + 150.f}, {50.f, 30.f}, 15, main_font);
     ui::TextBox range_start_input_box({kWidth - kSliderXOffset - 50.f, kOptionsPanelHeight + 100.f}, {50.f, 30.f}, 15, main_font);
     ui::TextBox range_end_input_box({kWidth - kSliderXOffset - 50.f, kOptionsPanelHeight + 50.f}, {50.f, 30.f}, 15, main_font);
-
-    ui::HarmonicScreen harmonic_screen({kWidth / 2.f + 20.0f, -kHeight + 325.f}, {kWidth / 4.0f, 150.0f}, fourier_sim.GetHarmonics(), sf::Color::Black);
+    ui::TextBox subset_input_box({kSliderXOffset + 60.f, kOptionsPanelHeight + 10.f}, {kSliderWidth - 60.f, 25.f}, 14, main_font);
+
+    ui::HarmonicScreen harmonic_screen({kWidth / 2.f + 20.0f, -kHeight + 325.f}, {kWidth / 4.0f, 150.0f}, sf::Color::Black);
+
+    // Amplitude and phase of every coefficient, an inset in the plot's top right corner (key S)
+    const sf::Vector2f kSpectrumSize = {240.f, 140.f};
+    ui::SpectrumScreen spectrum_screen({kWidth - kSpectrumSize.x - 10.f, kOptionsPanelHeight + kPanelHeight + kPlotHeight - kSpectrumSize.y - 10.f}, kSpectrumSize);
+
+    // Panels do not overlap the harmonic screen, sliders or text boxes drawn over them,
+    // so all of them can go first in one batch with the captions
+    options_panel.Bake(panel_layer);
+    division_panel.Bake(panel_layer);
+    slices_panel.Bake(panel_layer);
+    harmonics_panel.Bake(panel_layer);
+    for (const sf::Text* caption : {&max_value_text, &range_start_text, &range_end_text, &user_info_text, &subset_text}) {
+        panel_layer.AddText(*caption);
+    }
 
     function_input_box.SetText("sin(x*x) + x/10");
     max_value_input_box.SetText(round_to_string(slider_max_val, 0));
     range_start_input_box.SetText(round_to_string(range_start, 2));
     range_end_input_box.SetText(round_to_string(range_end, 2));
 
+    // Widgets that mark themselves dirty, repainted alone when nothing else changed
+    const std::array<ui::Slider*, 2> sliders = {&harmonics_slider, &slices_slider};
+    const std::array<ui::TextBox*, 5> text_boxes = {&function_input_box, &max_value_input_box, &range_start_input_box, 
+                                                    &range_end_input_box, &subset_input_box};
+
+    // Frames are composed offscreen and only invalidated regions are repainted, so typing
+    // or dragging a handle does not redraw the plot
+    ui::FrameComposer composer(view);
+    if (!composer.Resize({static_cast<unsigned int>(kWidth), static_cast<unsigned int>(kHeight)})) {
+        return -1;
+    }
+    const sf::FloatRect kPlotRegion({0.f, kOptionsPanelHeight + kPanelHeight}, {kWidth, kPlotHeight});
+
     // Initial function setup
     std::vector<sf::Vertex> equation_points = {};
     std::vector<sf::Vertex> fourier_points = {};
 
+    // Series strips of the last rebuild and the period copies they are drawn at
+    std::vector<std::vector<sf::Vertex>> fourier_strips;
+    float period = range_end - range_start;
+    long long first_copy = 0;
+    long long last_copy = 0;
+
     float last_harmonics = -1.f;
     float last_slices = -1.f;
+    // Plot view for the current viewport, y up like the rest of the window
+    auto make_plot_view = [&]() {
+        sf::View plot_view;
+        plot_view.setSize({kWidth / zoom, -kPlotHeight / zoom});
+        plot_view.setCenter(plot_center);
+        plot_view.setViewport(sf::FloatRect({0.f, 0.f}, {1.f, kPlotHeight / kHeight}));
+        return plot_view;
+    };
+
+    auto invalidate_widgets = [&]() {
+        for (ui::Slider* slider : sliders) {
+            if (slider->IsDirty()) {
+                composer.Invalidate(slider->GetBounds());
+                slider->ClearDirty();
+            }
+        }
+        for (ui::TextBox* text_box : text_boxes) {
+            if (text_box->IsDirty()) {
+                composer.Invalidate(text_box->GetBounds());
+                text_box->ClearDirty();
+            }
+        }
+        if (harmonic_screen.IsDirty()) {
+            composer.Invalidate(harmonic_screen.GetBounds());
+            harmonic_screen.ClearDirty();
+        }
+        if (spectrum_screen.IsDirty()) {
+            composer.Invalidate(spectrum_screen.GetBounds());
+            spectrum_screen.ClearDirty();
+        }
+    };
+
+    // Both the old and the new extent of a label are repainted
+    auto set_label = [&](sf::Text& label, const std::string& value) {
+        if (label.getString().toAnsiString() == value) {
+            return;
+        }
+        composer.Invalidate(label.getGlobalBounds());
+        label.setString(value);
+        composer.Invalidate(label.getGlobalBounds());
+    };
+
+    // The whole scene as seen through one dirty region. The scissor clips the pixels,
+    // the bounds tests skip the draw calls of widgets the region does not reach.
+    auto paint = [&](sf::RenderTarget& target, const sf::FloatRect& region) {
+        auto reaches = [&](const sf::FloatRect& bounds) { return region.findIntersection(bounds).has_value(); };
+
+        // Only the region is cleared, the scissor applies to clearing too
+        target.clear(sf::Color::Black);
+
+        if (reaches(kPlotRegion)) {
+            // Axis, ticks and labels: a line batch and a glyph batch
+            axis_layer.Draw(target);
+
+            // Draw function points
+            const sf::View vistaOriginal = target.getView();
+            target.setView(ui::FrameComposer::WithScissor(make_plot_view(), target));
+            if (!equation_points.empty()) {
+                target.draw(equation_points.data(), equation_points.size(), sf::PrimitiveType::LineStrip);
+            }
+
+            for (long long copy = first_copy; copy <= last_copy; ++copy) {
+                sf::RenderStates states;
+                states.transform.translate({static_cast<float>(copy) * period * kPixelsPerUnit, 0.f});
+                for (const std::vector<sf::Vertex>& strip : fourier_strips) {
+                    if (!strip.empty()) {
+                        target.draw(strip.data(), strip.size(), sf::PrimitiveType::LineStrip, states);
+                    }
+                }
+            }
+
+            target.setView(vistaOriginal);
+        }
+
+        // Spectrum inset over the plot
+        if (spectrum_screen.IsVisible() && reaches(spectrum_screen.GetBounds())) {
+            spectrum_screen.Draw(target);
+        }
+
+        // Draw panels and their captions
+        panel_layer.Draw(target);
+
+        // Draw Screen with harmonics
+        if (reaches(harmonic_screen.GetBounds())) {
+            harmonic_screen.Draw(target);
+        }
+
+        // Draw sliders
+        for (const ui::Slider* slider : sliders) {
+            if (reaches(slider->GetBounds())) {
+                slider->Draw(target);
+            }
+        }
+
+        // Draw texts
+        for (const sf::Text* label : {&harmonics_value, &slices_value}) {
+            if (reaches(label->getGlobalBounds())) {
+                target.draw(*label);
+            }
+        }
+
+        // Draw text boxes
+        for (const ui::TextBox* text_box : text_boxes) {
+            if (reaches(text_box->GetBounds())) {
+                text_box->Draw(target);
+            }
+        }
+    };
+
     while (window.isOpen()){
+        bool view_changed = false;
+
         while(const std::optional event = window.pollEvent()){
             if (event->is<sf::Event::Closed>()){
+                fourier_sim::DefaultPlanCache().Save(kPlanCachePath);
+                if (fourier_sim.AreEnginesTuned()) {
+                    fourier_sim.SaveEngineWisdom(kWisdomPath);
+                }
                 window.close();
             }
 
+            // Shortcuts only while no text box takes the keyboard
+            bool typing = function_input_box.IsFocused() || max_value_input_box.IsFocused() ||
+                          range_start_input_box.IsFocused() || range_end_input_box.IsFocused() ||
+                          subset_input_box.IsFocused();
+
+            if (const auto* key = event->getIf<sf::Event::KeyPressed>(); key && !typing) {
+                if (key->code == sf::Keyboard::Key::A) {
+                    adaptive_sampling = !adaptive_sampling;
+                    fourier_sim.SetAdaptiveTolerance(adaptive_sampling ? kAdaptiveTolerance : 0.0f);
+
+                    // Just to force redraw
+                    last_harmonics = -1.0f;
+                }
+                if (key->code == sf::Keyboard::Key::E) {
+                    // Benchmarks the engines once, a fraction of a second, kept for later runs
+                    fourier_sim.TuneEngines();
+                    fourier_sim.SaveEngineWisdom(kWisdomPath);
+                }
+                if (key->code == sf::Keyboard::Key::T) {
+                    auto_harmonics = !auto_harmonics;
+
+                    // Just to force redraw
+                    last_harmonics = -1.0f;
+                }
+                if (key->code == sf::Keyboard::Key::H) {
+                    // Latest harmonic, then the first band overlaid, then stacked
+                    const ui::HarmonicView next = (harmonic_screen.GetView() == ui::HarmonicView::kLatest) ? ui::HarmonicView::kOverlay :
+                                                  (harmonic_screen.GetView() == ui::HarmonicView::kOverlay) ? ui::HarmonicView::kStacked :
+                                                                                                             ui::HarmonicView::kLatest;
+                    harmonic_screen.SetView(next);
+                }
+                if (key->code == sf::Keyboard::Key::S) {
+                    spectrum_screen.SetVisible(!spectrum_screen.IsVisible());
+                }
+                if (key->code == sf::Keyboard::Key::L) {
+                    // Linear, log amplitude, log-log
+                    const ui::SpectrumScale next = (spectrum_screen.GetScale() == ui::SpectrumScale::kLinear) ? ui::SpectrumScale::kLogAmplitude :
+                                                   (spectrum_screen.GetScale() == ui::SpectrumScale::kLogAmplitude) ? ui::SpectrumScale::kLogLog :
+                                                                                                                    ui::SpectrumScale::kLinear;
+                    spectrum_screen.SetScale(next);
+                }
+                if (key->code == sf::Keyboard::Key::P) {
+                    periodic_extension = !periodic_extension;
+
+                    // Just to force redraw
+                    last_harmonics = -1.0f;
+                }
+                if (key->code == sf::Keyboard::Key::R) {
+                    decimation = (decimation == fourier_sim::DecimationMode::kRdp) ? fourier_sim::DecimationMode::kMinMax 
+                                                                                  : fourier_sim::DecimationMode::kRdp;
+
+                    // Just to force redraw
+                    last_harmonics = -1.0f;
+                }
+            }
+
+            // Zoom and pan only inside the plot, the panel below keeps its clicks
+            if (const auto* wheel = event->getIf<sf::Event::MouseWheelScrolled>(); wheel && wheel->wheel == sf::Mouse::Wheel::Vertical && 
+                                                                                      wheel->position.y < kPlotHeight) {
+                // The world point under the cursor stays put
+                const sf::Vector2f anchor = window.mapPixelToCoords(wheel->position, make_plot_view());
+                const float new_zoom = std::clamp(zoom * std::pow(kZoomStep, wheel->delta), kMinZoom, kMaxZoom);
+                plot_center = anchor + (plot_center - anchor) * (zoom / new_zoom);
+                zoom = new_zoom;
+                view_changed = true;
+                axis_stale = true;
+            }
+            if (const auto* press = event->getIf<sf::Event::MouseButtonPressed>(); 
+                press && press->button == sf::Mouse::Button::Left && press->position.y < kPlotHeight) {
+                panning = true;
+                pan_anchor = press->position;
+                pan_anchor_center = plot_center;
+            }
+            if (const auto* release = event->getIf<sf::Event::MouseButtonReleased>(); release && release->button == sf::Mouse::Button::Left) {
+                panning = false;
+            }
+            if (const auto* move = event->getIf<sf::Event::MouseMoved>(); move && panning) {
+                // Screen y grows downwards, world y upwards
+                plot_center = {pan_anchor_center.x - (move->position.x - pan_anchor.x) / zoom,
+                               pan_anchor_center.y + (move->position.y - pan_anchor.y) / zoom};
+                view_changed = true;
+                axis_stale = true;
+            }
+
             harmonics_slider.HandleEvent(*event, window);
             slices_slider.HandleEvent(*event, window);
             function_input_box.HandleEvent(*event, window);
             max_value_input_box.HandleEvent(*event, window);
             range_start_input_box.HandleEvent(*event, window);
             range_end_input_box.HandleEvent(*event, window);
+            subset_input_box.HandleEvent(*event, window);
         }
 
         float harmonics = harmonics_slider.GetValue();
         float slices = slices_slider.GetValue();
 
         bool has_changes = (last_harmonics != harmonics || 
-                            last_slices != slices || 
-                            function_input_box.IsFocused() || 
-                            max_value_input_box.IsFocused() ||
-                            range_start_input_box.IsFocused() || 
-                            range_end_input_box.IsFocused()
+                            last_slices != slices
                         );
 
-        if (!has_changes && !draw_last_loop) {
+        // A focused text box repaints only itself while typing, Enter hands the text over
+        bool inputs_ready = std::any_of(text_boxes.begin(), text_boxes.end(), [](const ui::TextBox* text_box) {
+            return text_box->IsReadyToDraw();
+        });
+
+        // Tiles finished in the background replace their coarser stand-ins
+        bool tiles_ready = tile_cache.TakeUpdates();
+
+        invalidate_widgets();
+        if (!has_changes && !view_changed && !tiles_ready && !inputs_ready && !composer.HasDirty()) {
             continue;
         }
 
-        draw_last_loop = has_changes;
+        const bool plot_changed = has_changes || view_changed || tiles_ready || inputs_ready;
 
         last_harmonics = harmonics;
         last_slices = slices;
 
+        // Slider at 0 allows an error of 1, at its end kAutoToleranceDecades decades less
+        const double tolerance = std::pow(10.0, -kAutoToleranceDecades * harmonics / std::max(slider_max_val, 1.f));
+
         if (has_changes) {
-            fourier_points = fourier_sim.GetUniversalFourier(harmonics, slices, target_func, range_start, range_end);
-            harmonic_screen.SetHarmonics(fourier_sim.GetHarmonics());
-            harmonic_screen.UpdateHarmonicIndex(static_cast<int>(harmonics));
+            // Recognized waveforms skip sampling, the slices slider has no effect on them
+            if (engine.HasWaveform() && !adaptive_sampling) {
+                if (auto_harmonics) {
+                    fourier_points = fourier_sim.GetAutoWaveformFourier(tolerance, kAutoMaxHarmonics, engine.GetWaveform(), range_start, range_end);
+                    harmonic_screen.SetSeries(fourier_sim.GetSeries(), fourier_sim.GetAutoReport().harmonics);
+                } else if (selected_harmonics.empty()) {
+                    fourier_points = fourier_sim.GetWaveformFourier(harmonics, engine.GetWaveform(), range_start, range_end);
+                    harmonic_screen.SetSeries(fourier_sim.GetSeries(), static_cast<int>(harmonics));
+                } else {
+                    fourier_points = fourier_sim.GetSelectedWaveformFourier(selected_harmonics, engine.GetWaveform(), range_start, range_end);
+                    harmonic_screen.SetSeries(fourier_sim.GetSeries(), static_cast<int>(selected_harmonics.size()) - 1);
+                }
+            } else {
+                // Kept until the function, slices or range change, so the harmonics slider alone never resamples
+                fourier_sim.SampleTarget(slices, target_func, range_start, range_end);
+                if (auto_harmonics) {
+                    fourier_points = fourier_sim.GetAutoSampledFourier(tolerance, kAutoMaxHarmonics);
+                    harmonic_screen.SetSeries(fourier_sim.GetSeries(), fourier_sim.GetAutoReport().harmonics);
+                } else if (selected_harmonics.empty()) {
+                    fourier_points = fourier_sim.GetSampledFourier(harmonics);
+                    harmonic_screen.SetSeries(fourier_sim.GetSeries(), static_cast<int>(harmonics));
+                } else {
+                    fourier_points = fourier_sim.GetSelectedSampledFourier(selected_harmonics);
+                    harmonic_screen.SetSeries(fourier_sim.GetSeries(), static_cast<int>(selected_harmonics.size()) - 1);
+                }
+            }
+
+            // A new series drops the tiles of the old one
+            tile_cache.SetSeries(fourier_sim.GetSeries());
+            spectrum_screen.SetSeries(fourier_sim.GetSeries());
         }
 
         // Check if new function input is ready
@@ -197,14 +525,31 @@ int main() {
             // Parse func_text to create a new target function
             engine.Compile(func_text);
             target_func = engine.GetTargetFunction();
+            fourier_sim.InvalidateSamples();
 
             // Reset sliders
             slices_slider.ResetValue();
             harmonics_slider.ResetValue();
 
+            // Just to force redraw
+            last_harmonics = -1.0f;
+
             function_input_box.ResetReadyToDraw();
         }
 
+        if (subset_input_box.IsReadyToDraw()) {
+            // Empty text goes back to the harmonics slider, indices stop at the slider maximum
+            std::vector<int> parsed;
+            if (fourier_sim::ParseHarmonicList(subset_input_box.GetText(), parsed, static_cast<int>(slider_max_val))) {
+                selected_harmonics = parsed;
+            }
+
+            // Just to force redraw
+            last_harmonics = -1.0f;
+
+            subset_input_box.ResetReadyToDraw();
+        }
+
         if (max_value_input_box.IsReadyToDraw()) {
             std::string max_value_text = max_value_input_box.GetText();
             if (max_value_text.empty()) {
@@ -229,7 +574,7 @@ int main() {
 
             try {
                 float user_range_start = std::stof(range_start_text);
-                range_start = std::clamp(user_range_start, 0.0f, range_end - 0.1f);                
+                range_start = std::clamp(user_range_start, -kRangeLimit, range_end - 0.1f);                
             } catch (const std::invalid_argument&) {}
             range_start_input_box.SetText(round_to_string(range_start, 2));
 
@@ -247,7 +592,7 @@ int main() {
 
             try {
                 float user_range_end = std::stof(range_end_text);
-                range_end = std::clamp(user_range_end, range_start + 0.1f, 16.0f);
+                range_end = std::clamp(user_range_end, range_start + 0.1f, kRangeLimit);
             } catch (const std::invalid_argument&) {}
             range_end_input_box.SetText(round_to_string(range_end, 2));
 
@@ -257,83 +602,144 @@ int main() {
             range_end_input_box.ResetReadyToDraw();
         }
         
-        // Create objective function points
-        equation_points = eq_sim::getInstance(target_func);
-
-        // Clear window
-        window.clear(sf::Color::Black);
-
-        // Here drawing starts 
-
-        window.draw(line_vertices.data(), line_vertices.size(), sf::PrimitiveType::Lines);
-        window.draw(grid_lines.data(), grid_lines.size(), sf::PrimitiveType::Lines);
-
-        // Draw labels
-        for (float x = 0.f; x<=kWidth; x += kTickSpacing){
-            label_text.setString(std::to_string(static_cast<int>(x / 50.f)));
-            sf::FloatRect bounds = label_text.getLocalBounds();
-            label_text.setOrigin({bounds.size.x / 2.0f, 0.0f});
-            label_text.setPosition({x, -20.f});
-            window.draw(label_text);
-        }
-
-        // Update and draw slider value
-        harmonics_value.setString("Harmonics: " + std::to_string(static_cast<int>(harmonics)));
-        slices_value.setString("Slices: " + std::to_string(static_cast<int>(slices)));
-
-
-        sf::View vistaOriginal = window.getView();
-        sf::View screen;
-
-        screen.setSize({kWidth, -(kHeight - kPanelHeight)});
-        screen.setCenter({kWidth / 2.f, 0.f});
-
-        // Taking into account position of y axis
-        screen.setViewport(sf::FloatRect({0.f, 0.f}, {kWidth / kWidth, (kHeight - kPanelHeight) / kHeight}));
+        if (plot_changed) {
+            // Visible world span, one plot pixel column is column_width world units
+            const sf::View screen = make_plot_view();
+            const float view_left = plot_center.x - kWidth / (2.f * zoom);
+            const float view_right = plot_center.x + kWidth / (2.f * zoom);
+            const float column_width = 1.f / zoom;
+
+            // Create objective function points, denser where the curve bends or climbs
+            equation_points = fourier_sim::Decimate(eq_sim::getAdaptiveInstance(target_func, view_left / kPixelsPerUnit, view_right / kPixelsPerUnit, column_width),
+                                                    decimation, column_width);
+
+            // Series over the visible part of one period, from the tiles of the zoom's level.
+            // Further periods draw the same strips again under a translation, nothing is resampled.
+            fourier_strips.clear();
+            period = range_end - range_start;
+            first_copy = 0;
+            last_copy = 0;
+            if (tile_cache.HasSeries()) {
+                const float left = view_left / kPixelsPerUnit;
+                const float right = view_right / kPixelsPerUnit;
+
+                // [lo, hi] of the base period, plus [range_start, wrap_end] when the view crosses a period end
+                float lo = std::max(left, range_start);
+                float hi = std::min(right, range_end);
+                float wrap_end = range_start;
+                if (periodic_extension) {
+                    first_copy = static_cast<long long>(std::floor((left - range_start) / period));
+                    last_copy = static_cast<long long>(std::floor((right - range_start) / period));
+                    if (right - left >= period) {
+                        lo = range_start;
+                        hi = range_end;
+                    } else {
+                        lo = left - static_cast<float>(first_copy) * period;
+                        hi = std::min(lo + (right - left), range_end);
+                        wrap_end = std::max(range_start, lo + (right - left) - period);
+                    }
+                }
+
+                const int level = tile_cache.LevelFor(column_width / kPixelsPerUnit);
+                for (const auto& [strip_lo, strip_hi] : {std::make_pair(range_start, wrap_end), std::make_pair(lo, hi)}) {
+                    if (!(strip_hi > strip_lo)) {
+                        continue;
+                    }
+                    tile_cache.Collect(strip_lo, strip_hi, level, tile_x, tile_y);
+
+                    std::vector<sf::Vertex> strip(tile_x.size());
+                    for (size_t j = 0; j < tile_x.size(); ++j) {
+                        strip[j].position = {tile_x[j] * kPixelsPerUnit, tile_y[j] * kPixelsPerUnit};
+                        strip[j].color = sf::Color::Yellow;
+                    }
+                    fourier_strips.push_back(fourier_sim::Decimate(strip, decimation, column_width));
+                }
+
+                // Zoomed out over many short periods: the whole view is one strip of the full
+                // period repeated, cut back to the pixel columns, so it costs one draw call.
+                // The series is periodic, so joining one copy's end to the next start is exact.
+                if (last_copy - first_copy >= kMaxPeriodDraws && !fourier_strips.empty()) {
+                    const std::vector<sf::Vertex>& base = fourier_strips.back();
+                    std::vector<sf::Vertex> repeated;
+                    repeated.reserve(base.size() * static_cast<size_t>(last_copy - first_copy + 1));
+                    for (long long copy = first_copy; copy <= last_copy; ++copy) {
+                        const float offset = static_cast<float>(copy) * period * kPixelsPerUnit;
+                        for (sf::Vertex vertex : base) {
+                            vertex.position.x += offset;
+                            repeated.push_back(vertex);
+                        }
+                    }
+                    fourier_strips.assign(1, fourier_sim::Decimate(repeated, decimation, column_width));
+                    first_copy = 0;
+                    last_copy = 0;
+                }
+            } else {
+                fourier_strips.push_back(fourier_sim::Decimate(fourier_points, decimation, column_width));
+            }
 
+            // Axis with ticks about every kTickSpacing plot pixels, at a round step in math units.
+            // Baked in window coordinates, so it draws under the default view with the panels.
+            if (axis_stale) {
+                axis_layer.Clear();
+
+                const float tick_step = nice_tick_step(kTickSpacing / (zoom * kPixelsPerUnit));
+                const int label_decimals = std::max(0, static_cast<int>(std::ceil(-std::log10(tick_step) - 1e-4f)));
+                const sf::Vector2f origin = window.mapPixelToCoords(window.mapCoordsToPixel({0.f, 0.f}, screen), view);
+                axis_layer.AddLine({0.f, origin.y}, {kWidth, origin.y}, sf::Color::White);
+
+                const long long first_tick = static_cast<long long>(std::ceil(view_left / kPixelsPerUnit / tick_step));
+                const long long last_tick = static_cast<long long>(std::floor(view_right / kPixelsPerUnit / tick_step));
+                for (long long k = first_tick; k <= last_tick; ++k) {
+                    const float x = static_cast<float>(k) * tick_step * kPixelsPerUnit;
+                    sf::Vector2i pixel = window.mapCoordsToPixel({x, 0.f}, screen);
+                    const sf::Vector2f tick = window.mapPixelToCoords(pixel, view);
+                    axis_layer.AddLine({tick.x, tick.y + kTickSize}, {tick.x, tick.y - kTickSize}, sf::Color::White);
+
+                    // Labels under the ticks, kept inside the plot when the axis is panned away
+                    pixel.y = std::clamp(pixel.y, 0, static_cast<int>(kPlotHeight) - 40);
+                    sf::Transform placement;
+                    placement.translate(window.mapPixelToCoords(pixel, view) - sf::Vector2f(0.f, 20.f));
+                    placement.scale({1.f, -1.f});
+                    axis_layer.AddText(main_font, round_to_string(static_cast<float>(k) * tick_step, label_decimals), kLabelSize, 
+                                       sf::Color::White, placement, {0.5f, 0.f});
+                }
+
+                axis_stale = false;
+            }
 
-        // Draw function points
-        window.setView(screen);
-        if (!equation_points.empty()) {
-            window.draw(equation_points.data(), equation_points.size(), sf::PrimitiveType::LineStrip);
-        }
+            // Update slider values
+            // Mean-square error by Parseval, the generator tracked it while building the series
+            // Past half the sample grid the harmonics alias and the error is not known
+            const fourier_sim::ConvergenceReport convergence = fourier_sim.GetConvergenceReport();
+            const std::string error_text = convergence.reliable ? " (MSE " + scientific_to_string(convergence.mean_square_error) + ")" 
+                                                                : std::string(" (MSE unknown, aliased)");
+            if (auto_harmonics) {
+                set_label(harmonics_value, "Tolerance " + scientific_to_string(tolerance) + 
+                                           (fourier_sim.GetAutoReport().converged ? ": " : " missed: ") + 
+                                           std::to_string(fourier_sim.GetAutoReport().harmonics) + " harmonics" + error_text);
+            } else {
+                set_label(harmonics_value, "Harmonics: " + std::to_string(static_cast<int>(harmonics)) + error_text);
+            }
+            if (adaptive_sampling) {
+                set_label(slices_value, "Slices: " + std::to_string(static_cast<int>(slices)) + 
+                                        " (adaptive, " + std::to_string(fourier_sim.GetAdaptiveReport().evaluations) + " used)");
+            } else if (engine.HasWaveform()) {
+                set_label(slices_value, "Slices: " + std::to_string(static_cast<int>(slices)) + " (closed form, unused)");
+            } else if (!fourier_sim.GetBreakpoints().empty()) {
+                set_label(slices_value, "Slices: " + std::to_string(static_cast<int>(slices)) + 
+                                        " (" + std::to_string(fourier_sim.GetBreakpoints().size()) + " breakpoints)");
+            } else {
+                set_label(slices_value, "Slices: " + std::to_string(static_cast<int>(slices)));
+            }
 
-        if (!fourier_points.empty()) {
-            window.draw(fourier_points.data(), fourier_points.size(), sf::PrimitiveType::LineStrip);
+            composer.Invalidate(kPlotRegion);
         }
 
-        window.setView(vistaOriginal);
-
-        // Draw options panel
-        options_panel.Draw(window);
-        division_panel.Draw(window);
-
-        // Draw Screen with harmonics
-        harmonic_screen.Draw(window);
-
-        // Draw slider panel
-        slices_panel.Draw(window);
-        harmonics_panel.Draw(window);
-
-        // Draw sliders
-        harmonics_slider.Draw(window);
-        slices_slider.Draw(window);
-
-        // Draw texts
-        window.draw(harmonics_value);
-        window.draw(slices_value);
-        window.draw(max_value_text);
-        window.draw(range_start_text);
-        window.draw(range_end_text);
-        window.draw(user_info_text);
-
-        // Draw text boxes
-        function_input_box.Draw(window);
-        max_value_input_box.Draw(window);
-        range_start_input_box.Draw(window);
-        range_end_input_box.Draw(window);
+        // Repaint what changed offscreen, then show the whole frame
+        invalidate_widgets();
+        composer.Compose(paint);
+        composer.Present(window);
 
-        // Here drawing ends
         window.display();
     }
 
@@ -0,0 +1,116 @@
+#include "harmonic_selection.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace fourier_sim {
+
+namespace {
+
+void SortUnique(std::vector<int>& indices) {
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+bool ParseIndex(const std::string& text, int& value) {
+    // isdigit is undefined for negative char values, e.g. bytes of UTF-8 text
+    auto is_digit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+    if (text.empty() || !std::all_of(text.begin(), text.end(), is_digit)) {
+        return false;
+    }
+
+    try {
+        value = std::stoi(text);
+    } catch (const std::out_of_range&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<int> SingleHarmonic(int index) {
+    if (index < 0) {
+        return {};
+    }
+    return {index};
+}
+
+std::vector<int> HarmonicRange(int first, int last, int step) {
+    std::vector<int> indices;
+    if (step <= 0) {
+        return indices;
+    }
+
+    first = std::max(first, 0);
+    if (first > last) {
+        return indices;
+    }
+
+    // Stops before n += step could pass INT_MAX
+    for (int n = first; ; n += step) {
+        indices.push_back(n);
+        if (last - n < step) {
+            break;
+        }
+    }
+    return indices;
+}
+
+std::vector<int> OddHarmonics(int last) {
+    return HarmonicRange(1, last, 2);
+}
+
+bool ParseHarmonicList(const std::string& text, std::vector<int>& indices, int max_index) {
+    std::string cleaned;
+    for (char c : text) {
+        if (c != ' ') {
+            cleaned += c;
+        }
+    }
+
+    std::vector<int> parsed;
+    std::stringstream stream(cleaned);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+
+        int step = 1;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            if (!ParseIndex(item.substr(slash + 1), step) || step == 0) {
+                return false;
+            }
+            item = item.substr(0, slash);
+        }
+
+        // A step only belongs to a range, "5/2" is an error rather than harmonic 5
+        size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            int index = 0;
+            if (slash != std::string::npos || !ParseIndex(item, index) || index > max_index) {
+                return false;
+            }
+            parsed.push_back(index);
+            continue;
+        }
+
+        int first = 0;
+        int last = 0;
+        if (!ParseIndex(item.substr(0, dash), first) || !ParseIndex(item.substr(dash + 1), last) || first > last || 
+            last > max_index) {
+            return false;
+        }
+
+        std::vector<int> range = HarmonicRange(first, last, step);
+        parsed.insert(parsed.end(), range.begin(), range.end());
+    }
+
+    SortUnique(parsed);
+    indices = parsed;
+    return true;
+}
+
+} // namespace fourier_sim
@@ -0,0 +1,23 @@
+#ifndef HARMONIC_SELECTION_H_
+#define HARMONIC_SELECTION_H_
+
+#include <string>
+#include <vector>
+
+namespace fourier_sim {
+
+// Helpers to build sorted, duplicate-free lists of harmonic indices
+std::vector<int> SingleHarmonic(int index);
+std::vector<int> HarmonicRange(int first, int last, int step = 1);
+std::vector<int> OddHarmonics(int last);
+
+// Largest index a parsed list may hold unless the caller sets a bound
+const int kMaxHarmonicIndex = 1 << 16;
+
+// Parses a user list such as "0,1,3,5-9,11-51/2" (a-b/c takes every c-th index of a range)
+// Returns false and leaves indices untouched on malformed input or an index above max_index
+bool ParseHarmonicList(const std::string& text, std::vector<int>& indices, int max_index = kMaxHarmonicIndex);
+
+} // namespace fourier_sim
+
+#endif  // HARMONIC_SELECTION_H_
@@ -3,35 +3,65 @@
 
 namespace ui {
 
-struct MathParser::Impl {
-    float x_var = 0.0f;
-    exprtk::symbol_table<float> symbol_table;
-    exprtk::expression<float> expression;
-    exprtk::parser<float> parser;
+template <typename T>
+struct BasicMathParser<T>::Impl {
+    T x_var = T(0);
+    exprtk::symbol_table<T> symbol_table;
+    exprtk::expression<T> expression;
+    exprtk::parser<T> parser;
+
+    fourier_sim::Waveform waveform;
+    bool has_waveform = false;
 
     Impl() {
         symbol_table.add_variable("x", x_var);
         symbol_table.add_constants();
+        symbol_table.add_function("square", &fourier_sim::SquareWave<T>);
+        symbol_table.add_function("sawtooth", &fourier_sim::SawtoothWave<T>);
+        symbol_table.add_function("triangle", &fourier_sim::TriangleWave<T>);
+        symbol_table.add_function("pulse", &fourier_sim::PulseWave<T>);
         expression.register_symbol_table(symbol_table);
     }
 };
 
-MathParser::MathParser() : pimpl_(new Impl()) {}
-MathParser::~MathParser() { delete pimpl_; }
+template <typename T>
+BasicMathParser<T>::BasicMathParser() : pimpl_(new Impl()) {}
+
+template <typename T>
+BasicMathParser<T>::~BasicMathParser() { delete pimpl_; }
 
-bool MathParser::Compile(const std::string& formula) {
-    return pimpl_->parser.compile(formula, pimpl_->expression);
+template <typename T>
+bool BasicMathParser<T>::Compile(const std::string& formula) {
+    bool compiled = pimpl_->parser.compile(formula, pimpl_->expression);
+    pimpl_->has_waveform = compiled && fourier_sim::ParseWaveform(formula, pimpl_->waveform);
+    return compiled;
 }
 
-float MathParser::Evaluate(float x) {
+template <typename T>
+T BasicMathParser<T>::Evaluate(T x) {
     pimpl_->x_var = x;
     return pimpl_->expression.value();
 }
 
-std::function<float(float)> MathParser::GetTargetFunction() {
-    return [this](float x) -> float {
+template <typename T>
+std::function<T(T)> BasicMathParser<T>::GetTargetFunction() {
+    return [this](T x) -> T {
         return this->Evaluate(x);
     };
 }
 
-} // namespace ui
\ No newline at end of file
+template <typename T>
+bool BasicMathParser<T>::HasWaveform() const {
+    return pimpl_->has_waveform;
+}
+
+template <typename T>
+const fourier_sim::Waveform& BasicMathParser<T>::GetWaveform() const {
+    return pimpl_->waveform;
+}
+
+template class BasicMathParser<float>;
+template class BasicMathParser<double>;
+template class BasicMathParser<long double>;
+
+} // namespace ui
@@ -3,22 +3,33 @@
 
 #include <string>
 #include <functional>
+#include "waveform.h"
 
 namespace ui {
-    class MathParser {
+    // ExprTk is instantiated for float, double and long double in math_engine.cpp,
+    // the rest of the program only sees this header.
+    template <typename T>
+    class BasicMathParser {
     public:
-        MathParser();
-        ~MathParser();
+        BasicMathParser();
+        ~BasicMathParser();
 
         bool Compile(const std::string& formula);
-        float Evaluate(float x);
+        T Evaluate(T x);
 
-        std::function<float(float)> GetTargetFunction();
+        std::function<T(T)> GetTargetFunction();
+
+        // Set when the compiled formula is a sum of built-in waveforms and polynomials,
+        // so the coefficients can come from closed forms instead of samples
+        bool HasWaveform() const;
+        const fourier_sim::Waveform& GetWaveform() const;
 
     private:
         struct Impl;
         Impl* pimpl_;
     };
+
+    using MathParser = BasicMathParser<float>;
 }
 
-#endif
\ No newline at end of file
+#endif
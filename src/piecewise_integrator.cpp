@@ -0,0 +1,336 @@
+#include "piecewise_integrator.h"
+#include "quadrature.h"
+#include <algorithm>
+#include <cmath>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+
+    // A difference this many times its neighbours is a breakpoint candidate
+    const double kCandidateRatio = 4.0;
+
+    // Jumps and kinks smaller than this fraction of max |f| are left to the smooth rule
+    const double kMinJump = 1e-3;
+    const double kMinKink = 1e-4;
+
+    // Interior grid points closer than this fraction of a step to a segment end are
+    // dropped, a near-duplicate node would make the edge quadratic ill-conditioned
+    const double kMinNodeGap = 0.25;
+
+    const int kMaxBisections = 64;
+
+    // Largest miss between f and the secant corner, as a fraction of the second difference
+    const double kKinkMismatch = 0.1;
+} // namespace
+
+template <typename T>
+void PiecewiseIntegrator<T>::Build(const Function& target_func, const std::vector<T>& samples, T range_start, T range_end) {
+    range_start_ = range_start;
+    range_end_ = range_end;
+    panels_ = static_cast<int>(samples.size()) - 1;
+    extra_evaluations_ = 0;
+
+    breakpoints_.clear();
+    left_values_.clear();
+    right_values_.clear();
+    runs_.clear();
+    run_values_.clear();
+    edges_.clear();
+
+    if (panels_ < 2) {
+        even_.clear();
+        odd_.clear();
+        return;
+    }
+
+    step_ = (static_cast<A>(range_end) - range_start) / panels_;
+    even_.assign(panels_, T(0));
+    odd_.assign(panels_, T(0));
+
+    Detect(target_func, samples);
+
+    A lo = range_start;
+    A f_lo = samples.front();
+    for (size_t k = 0; k < breakpoints_.size(); ++k) {
+        BuildSegment(target_func, samples, lo, f_lo, breakpoints_[k].x, left_values_[k]);
+        lo = breakpoints_[k].x;
+        f_lo = right_values_[k];
+    }
+    BuildSegment(target_func, samples, lo, f_lo, range_end, samples.back());
+}
+
+template <typename T>
+void PiecewiseIntegrator<T>::Detect(const Function& target_func, const std::vector<T>& samples) {
+    const int N = panels_;
+
+    A scale = 0;
+    for (T value : samples) {
+        scale = std::max(scale, static_cast<A>(std::abs(value)));
+    }
+    if (scale == 0 || !std::isfinite(scale)) {
+        return;
+    }
+
+    std::vector<A> diff(N);
+    for (int i = 0; i < N; ++i) {
+        diff[i] = static_cast<A>(samples[i + 1]) - samples[i];
+    }
+
+    auto eval = [&](A x) {
+        ++extra_evaluations_;
+        return static_cast<A>(target_func(static_cast<T>(x)));
+    };
+
+    // Jumps: one difference towering over both neighbours, confirmed by bisection
+    std::vector<bool> near_jump(N + 1, false);
+    for (int i = 0; i < N; ++i) {
+        A neighbours = std::max(i > 0 ? std::abs(diff[i - 1]) : A(0), i + 1 < N ? std::abs(diff[i + 1]) : A(0));
+        if (std::abs(diff[i]) < kMinJump * scale || std::abs(diff[i]) < kCandidateRatio * neighbours) {
+            continue;
+        }
+
+        A l = GridX(i);
+        A r = GridX(i + 1);
+        A fl = samples[i];
+        A fr = samples[i + 1];
+        for (int k = 0; k < kMaxBisections; ++k) {
+            A m = (l + r) / 2;
+            // Stop at the resolution of T, the function cannot be sampled any finer
+            if (static_cast<T>(m) == static_cast<T>(l) || static_cast<T>(m) == static_cast<T>(r)) {
+                break;
+            }
+            A fm = eval(m);
+            if (std::abs(fm - fl) > std::abs(fr - fm)) {
+                r = m;
+                fr = fm;
+            } else {
+                l = m;
+                fl = fm;
+            }
+        }
+
+        // A steep but continuous stretch flattens out under bisection
+        if (std::abs(fr - fl) < kMinJump * scale / 2) {
+            continue;
+        }
+
+        // The last difference bisects onto range_end when f jumps at the period wrap. That is
+        // no interior breakpoint: it is clamped to the range end, whose grid sample belongs
+        // to the next period, and its one-sided value closes the segment instead
+        A x = (l + r) / 2;
+        const A gap = kMinNodeGap * step_;
+        if (x - static_cast<A>(range_start_) < gap) {
+            x = range_start_;
+        } else if (static_cast<A>(range_end_) - x < gap) {
+            x = range_end_;
+        }
+
+        breakpoints_.push_back({static_cast<double>(x), true});
+        left_values_.push_back(fl);
+        right_values_.push_back(fr);
+        near_jump[i] = true;
+        near_jump[i + 1] = true;
+    }
+
+    // Kinks: a local peak of the second difference, located where the secants
+    // from both sides cross. Second differences next to a jump are ignored.
+    std::vector<A> second(N + 1, 0);
+    for (int i = 1; i < N; ++i) {
+        second[i] = diff[i] - diff[i - 1];
+    }
+
+    std::vector<Breakpoint> kinks;
+    std::vector<A> kink_values;
+    for (int i = 2; i + 2 <= N; ++i) {
+        if (near_jump[i - 1] || near_jump[i] || near_jump[i + 1]) {
+            continue;
+        }
+
+        A peak = std::abs(second[i]);
+        A neighbours = std::max(i - 2 >= 1 ? std::abs(second[i - 2]) : A(0), i + 2 < N ? std::abs(second[i + 2]) : A(0));
+        if (peak < kMinKink * scale || peak < std::abs(second[i - 1]) || peak < std::abs(second[i + 1]) ||
+            peak < kCandidateRatio * neighbours) {
+            continue;
+        }
+
+        A slope_left = diff[i - 2] / step_;
+        A slope_right = diff[i + 1] / step_;
+        if (std::abs(slope_right - slope_left) * step_ < kMinKink * scale) {
+            continue;
+        }
+
+        // Left secant through x_{i-1}, right secant through x_{i+1}
+        A x_left = GridX(i - 1);
+        A x_right = GridX(i + 1);
+        A f_left = samples[i - 1];
+        A f_right = samples[i + 1];
+        A x = (f_right - f_left + slope_left * x_left - slope_right * x_right) / (slope_left - slope_right);
+        if (!(x >= x_left && x <= x_right)) {
+            continue;
+        }
+
+        // At a true corner f meets both secants, on a merely curved stretch it misses
+        // them by a sizeable part of the second difference
+        A corner = f_left + slope_left * (x - x_left);
+        if (std::abs(eval(x) - corner) > kKinkMismatch * peak) {
+            continue;
+        }
+
+        kinks.push_back({static_cast<double>(x), false});
+        kink_values.push_back(corner);
+        ++i;
+    }
+
+    for (size_t k = 0; k < kinks.size(); ++k) {
+        breakpoints_.push_back(kinks[k]);
+        left_values_.push_back(kink_values[k]);
+        right_values_.push_back(kink_values[k]);
+    }
+
+    // Segments are built left to right
+    std::vector<size_t> order(breakpoints_.size());
+    for (size_t k = 0; k < order.size(); ++k) {
+        order[k] = k;
+    }
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return breakpoints_[a].x < breakpoints_[b].x; });
+
+    std::vector<Breakpoint> sorted;
+    std::vector<A> sorted_left;
+    std::vector<A> sorted_right;
+    for (size_t k : order) {
+        sorted.push_back(breakpoints_[k]);
+        sorted_left.push_back(left_values_[k]);
+        sorted_right.push_back(right_values_[k]);
+    }
+    breakpoints_ = sorted;
+    left_values_ = sorted_left;
+    right_values_ = sorted_right;
+}
+
+template <typename T>
+void PiecewiseIntegrator<T>::BuildSegment(const Function& target_func, const std::vector<T>& samples, A lo, A f_lo, A hi, A f_hi) {
+    if (hi <= lo) {
+        return;
+    }
+
+    const A gap = kMinNodeGap * step_;
+    int first = static_cast<int>(std::ceil((lo + gap - static_cast<A>(range_start_)) / step_));
+    int last = static_cast<int>(std::floor((hi - gap - static_cast<A>(range_start_)) / step_));
+    // The range ends are grid points themselves, a run reaching them needs no edge. A jump
+    // clamped onto an end replaces that sample, the run then stops a node short of it.
+    first = (lo <= static_cast<A>(range_start_) && f_lo == static_cast<A>(samples.front())) ? 0 : std::max(first, 0);
+    last = (hi >= static_cast<A>(range_end_) && f_hi == static_cast<A>(samples.back())) ? panels_ : std::min(last, panels_ - 1);
+
+    auto f_at = [&samples](int i) { return static_cast<A>(samples[i]); };
+
+    // Too short for a run: exact panels over whatever nodes exist
+    if (last - first < 2) {
+        std::vector<A> xs = {lo};
+        std::vector<A> fs = {f_lo};
+        for (int i = first; i <= last; ++i) {
+            if (GridX(i) <= lo || GridX(i) >= hi) {
+                continue;
+            }
+            xs.push_back(GridX(i));
+            fs.push_back(f_at(i));
+        }
+        xs.push_back(hi);
+        fs.push_back(f_hi);
+
+        if (xs.size() == 2) {
+            A middle = (lo + hi) / 2;
+            ++extra_evaluations_;
+            xs.insert(xs.begin() + 1, middle);
+            fs.insert(fs.begin() + 1, static_cast<A>(target_func(static_cast<T>(middle))));
+        }
+
+        // Three nodes cover the segment with one quadratic, four need two
+        edges_.push_back({{xs[0], xs[1], xs[2]}, {fs[0], fs[1], fs[2]}, xs[0], xs[2]});
+        if (xs.size() == 4) {
+            edges_.push_back({{xs[1], xs[2], xs[3]}, {fs[1], fs[2], fs[3]}, xs[2], xs[3]});
+        }
+        return;
+    }
+
+    const int run_last = last - ((last - first) % 2);
+    runs_.push_back({first, run_last});
+    run_values_.push_back(f_at(first));
+    run_values_.push_back(f_at(run_last));
+
+    // Index panels_ is range_end, which has the phase of index 0 for every harmonic
+    for (int i = first; i <= run_last; ++i) {
+        A weight = (i == first || i == run_last) ? A(0.5) : A(1);
+        std::vector<T>& target = ((i - first) % 2 == 0) ? even_ : odd_;
+        target[i % panels_] += static_cast<T>(weight * f_at(i));
+    }
+
+    // Edge from the breakpoint to the run, and from the run (plus a leftover node) to the next
+    if (first > 0 || lo > static_cast<A>(range_start_)) {
+        edges_.push_back({{lo, GridX(first), GridX(first + 1)}, {f_lo, f_at(first), f_at(first + 1)}, lo, GridX(first)});
+    }
+    if (run_last == last) {
+        if (last < panels_) {
+            edges_.push_back({{GridX(last - 1), GridX(last), hi}, {f_at(last - 1), f_at(last), f_hi}, GridX(last), hi});
+        }
+    } else if (last == panels_) {
+        // Odd panel count up to range_end, the last panel borrows the node before the run end
+        edges_.push_back({{GridX(run_last - 1), GridX(run_last), GridX(last)}, {f_at(run_last - 1), f_at(run_last), f_at(last)}, GridX(run_last), GridX(last)});
+    } else {
+        edges_.push_back({{GridX(run_last), GridX(last), hi}, {f_at(run_last), f_at(last), f_hi}, GridX(run_last), hi});
+    }
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> PiecewiseIntegrator<T>::Coefficients(EngineKind engine, const std::vector<int>& indices, SummationMode summation) const {
+    std::vector<HarmonicCoefficient<T>> coefficients(indices.size());
+    if (panels_ < 2) {
+        for (size_t k = 0; k < indices.size(); ++k) {
+            coefficients[k] = {indices[k], T(0), T(0)};
+        }
+        return coefficients;
+    }
+
+    std::vector<HarmonicCoefficient<T>> even_sums = ComputeCoefficients(engine, even_, range_start_, range_end_, indices, summation);
+    std::vector<HarmonicCoefficient<T>> odd_sums = ComputeCoefficients(engine, odd_, range_start_, range_end_, indices, summation);
+
+    const A L = (static_cast<A>(range_end_) - range_start_) / 2;
+
+    for (size_t k = 0; k < indices.size(); ++k) {
+        const int n = indices[k];
+        const A w = n * static_cast<A>(kPiLong) / L;
+
+        A alpha, beta, gamma;
+        FilonWeights(w * step_, alpha, beta, gamma);
+
+        A a = beta * even_sums[k].a + gamma * odd_sums[k].a;
+        A b = beta * even_sums[k].b + gamma * odd_sums[k].b;
+
+        // Filon end corrections of every run
+        for (size_t r = 0; r < runs_.size(); ++r) {
+            A x_first = GridX(runs_[r].first);
+            A x_last = GridX(runs_[r].last);
+            A f_first = run_values_[2 * r];
+            A f_last = run_values_[2 * r + 1];
+            a += (step_ / L) * alpha * (f_last * std::sin(w * x_last) - f_first * std::sin(w * x_first));
+            b -= (step_ / L) * alpha * (f_last * std::cos(w * x_last) - f_first * std::cos(w * x_first));
+        }
+
+        for (const EdgePanel& edge : edges_) {
+            std::complex<A> piece = QuadraticOscillatoryIntegral(edge.x, edge.f, edge.lo, edge.hi, w);
+            a += piece.real() / L;
+            b += piece.imag() / L;
+        }
+
+        coefficients[k] = {n, static_cast<T>(a), static_cast<T>(b)};
+    }
+
+    return coefficients;
+}
+
+template class PiecewiseIntegrator<float>;
+template class PiecewiseIntegrator<double>;
+template class PiecewiseIntegrator<long double>;
+
+} // namespace fourier_sim
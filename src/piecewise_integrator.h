@@ -0,0 +1,75 @@
+#ifndef PIECEWISE_INTEGRATOR_H_
+#define PIECEWISE_INTEGRATOR_H_
+
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+struct Breakpoint {
+    double x;
+    bool is_jump;   // false for a kink (jump in the first derivative)
+};
+
+// Splits [range_start, range_end] at jumps and kinks found on a uniform closed
+// grid and integrates every smooth segment separately. Jumps are located by
+// bisection (a few extra evaluations each), kinks by intersecting the one-sided
+// secant lines (one evaluation per candidate, to confirm the corner). The uniform interior of each segment is a Filon run
+// evaluated through the engines, only the short pieces next to a breakpoint
+// use exact panel integrals. Instantiated for float, double and long double.
+template <typename T>
+class PiecewiseIntegrator {
+
+    public:
+        using Function = std::function<T(T)>;
+
+        // samples hold f(range_start + i * T / panels) for i = 0..panels
+        void Build(const Function& target_func, const std::vector<T>& samples, T range_start, T range_end);
+
+        std::vector<HarmonicCoefficient<T>> Coefficients(EngineKind engine, const std::vector<int>& indices, SummationMode summation = SummationMode::kNaive) const;
+
+        const std::vector<Breakpoint>& GetBreakpoints() const { return breakpoints_; }
+        int GetExtraEvaluations() const { return extra_evaluations_; }
+
+    private:
+        using A = std::common_type_t<T, double>;
+
+        // Up to three samples integrated exactly over [lo, hi]
+        struct EdgePanel {
+            A x[3];
+            A f[3];
+            A lo, hi;
+        };
+
+        // Filon run over grid indices first..last (even count of panels)
+        struct Run {
+            int first, last;
+        };
+
+        void Detect(const Function& target_func, const std::vector<T>& samples);
+        void BuildSegment(const Function& target_func, const std::vector<T>& samples, A lo, A f_lo, A hi, A f_hi);
+        A GridX(int i) const { return static_cast<A>(range_start_) + i * step_; }
+
+        std::vector<Breakpoint> breakpoints_;
+        std::vector<A> left_values_;    // f just before each breakpoint
+        std::vector<A> right_values_;   // f just after each breakpoint
+
+        std::vector<T> even_;   // Filon even sums, half weights at run ends
+        std::vector<T> odd_;
+        std::vector<Run> runs_;
+        std::vector<A> run_values_;     // f at first, last of each run
+        std::vector<EdgePanel> edges_;
+
+        T range_start_ = T(0);
+        T range_end_ = T(0);
+        A step_ = 0;
+        int panels_ = 0;
+        int extra_evaluations_ = 0;
+
+};
+
+} // namespace fourier_sim
+
+#endif  // PIECEWISE_INTEGRATOR_H_
@@ -0,0 +1,163 @@
+#include "quadrature.h"
+#include <cmath>
+#include <type_traits>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+
+    // Below this theta the closed forms lose digits to cancellation
+    const double kFilonSeriesLimit = 1.0 / 6.0;
+
+    // Symmetric moments over [-h, h] divided by powers of h, theta = w h:
+    // K0 = int cos / 2h, K1 = int u sin / 2h^2, K2 = int u^2 cos / 2h^3
+    template <typename A>
+    void SymmetricMoments(A theta, A& k0, A& k1, A& k2) {
+        if (std::abs(theta) < kFilonSeriesLimit) {
+            A t2 = theta * theta;
+            k0 = A(1) - t2 * (A(1) / 6 - t2 * (A(1) / 120 - t2 * A(1) / 5040));
+            k1 = theta * (A(1) / 3 - t2 * (A(1) / 30 - t2 * (A(1) / 840 - t2 * A(1) / 45360)));
+            k2 = A(1) / 3 - t2 * (A(1) / 10 - t2 * (A(1) / 168 - t2 * A(1) / 6480));
+            return;
+        }
+
+        A s = std::sin(theta);
+        A c = std::cos(theta);
+        k0 = s / theta;
+        k1 = (s - theta * c) / (theta * theta);
+        k2 = (theta * theta * s + A(2) * theta * c - A(2) * s) / (theta * theta * theta);
+    }
+} // namespace
+
+template <typename A>
+void FilonWeights(A theta, A& alpha, A& beta, A& gamma) {
+    if (std::abs(theta) < kFilonSeriesLimit) {
+        A t2 = theta * theta;
+        A t3 = t2 * theta;
+        alpha = t3 * (A(2) / 45 - t2 * (A(2) / 315 - t2 * A(2) / 4725));
+        beta = A(2) / 3 + t2 * (A(2) / 15 - t2 * (A(4) / 105 - t2 * A(2) / 567));
+        gamma = A(4) / 3 - t2 * (A(2) / 15 - t2 * (A(1) / 210 - t2 * A(1) / 11340));
+        return;
+    }
+
+    A s = std::sin(theta);
+    A c = std::cos(theta);
+    A t3 = theta * theta * theta;
+    alpha = (theta * theta + theta * s * c - A(2) * s * s) / t3;
+    beta = A(2) * (theta * (A(1) + c * c) - A(2) * s * c) / t3;
+    gamma = A(4) * (s - theta * c) / t3;
+}
+
+const char* QuadratureName(QuadratureRule rule) {
+    switch (rule) {
+        case QuadratureRule::kRiemann: return "riemann";
+        case QuadratureRule::kSimpson: return "simpson";
+        case QuadratureRule::kFilon: return "filon";
+        case QuadratureRule::kPiecewise: return "piecewise";
+    }
+    return "unknown";
+}
+
+int QuadratureSampleCount(QuadratureRule rule, int slices) {
+    if (slices <= 0) {
+        return 0;
+    }
+    if (rule == QuadratureRule::kRiemann) {
+        return slices;
+    }
+    int panels = slices + (slices % 2);
+    return panels + 1;
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> IntegrateCoefficients(QuadratureRule rule, EngineKind engine, const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices, SummationMode summation) {
+    if (rule == QuadratureRule::kRiemann || samples.size() < 3) {
+        return ComputeCoefficients(engine, samples, range_start, range_end, indices, summation);
+    }
+
+    // Panels share the left-sum grid; f(range_end) has the phase of f(range_start)
+    // for every harmonic, so its weight folds onto index 0
+    const int N = static_cast<int>(samples.size()) - 1;
+
+    if (rule == QuadratureRule::kSimpson) {
+        std::vector<T> weighted(N);
+        for (int i = 0; i < N; ++i) {
+            weighted[i] = samples[i] * ((i == 0) ? T(1) / 3 : (i % 2 ? T(4) / 3 : T(2) / 3));
+        }
+        weighted[0] += samples[N] / 3;
+        return ComputeCoefficients(engine, weighted, range_start, range_end, indices, summation);
+    }
+
+    // Filon: h [alpha (f_N - f_0) sin(w x_0) + beta C_even + gamma C_odd], where the
+    // even sum carries half weights at both ends
+    std::vector<T> even(N, T(0));
+    std::vector<T> odd(N, T(0));
+    for (int i = 0; i < N; ++i) {
+        (i % 2 ? odd : even)[i] = samples[i];
+    }
+    even[0] = (samples[0] + samples[N]) / 2;
+
+    std::vector<HarmonicCoefficient<T>> even_sums = ComputeCoefficients(engine, even, range_start, range_end, indices, summation);
+    std::vector<HarmonicCoefficient<T>> odd_sums = ComputeCoefficients(engine, odd, range_start, range_end, indices, summation);
+
+    using A = std::common_type_t<T, double>;
+    const A T_period = static_cast<A>(range_end) - range_start;
+    const A L = T_period / 2;
+    const A h = T_period / N;
+    const A jump = static_cast<A>(samples[N]) - samples[0];
+
+    std::vector<HarmonicCoefficient<T>> coefficients(indices.size());
+    for (size_t k = 0; k < indices.size(); ++k) {
+        const int n = indices[k];
+        const A w = n * static_cast<A>(kPiLong) / L;
+
+        A alpha, beta, gamma;
+        FilonWeights(w * h, alpha, beta, gamma);
+
+        const A boundary = (h / L) * alpha * jump;
+        const A a = beta * even_sums[k].a + gamma * odd_sums[k].a + boundary * std::sin(w * range_start);
+        const A b = beta * even_sums[k].b + gamma * odd_sums[k].b - boundary * std::cos(w * range_start);
+
+        coefficients[k] = {n, static_cast<T>(a), static_cast<T>(b)};
+    }
+
+    return coefficients;
+}
+
+template <typename A>
+std::complex<A> QuadraticOscillatoryIntegral(const A x[3], const A f[3], A lo, A hi, A w) {
+    const A center = (lo + hi) / 2;
+    const A h = (hi - lo) / 2;
+
+    // Newton form in u = x - center, then monomial coefficients c0 + c1 u + c2 u^2
+    const A u0 = x[0] - center;
+    const A u1 = x[1] - center;
+    const A u2 = x[2] - center;
+    const A d1 = (f[1] - f[0]) / (u1 - u0);
+    const A d2 = ((f[2] - f[1]) / (u2 - u1) - d1) / (u2 - u0);
+
+    const A c2 = d2;
+    const A c1 = d1 - d2 * (u0 + u1);
+    const A c0 = f[0] - d1 * u0 + d2 * u0 * u1;
+
+    A k0, k1, k2;
+    SymmetricMoments(w * h, k0, k1, k2);
+
+    // Odd moments of cos and even moments of sin vanish on the symmetric interval
+    const A real_part = A(2) * h * (c0 * k0 + c2 * h * h * k2);
+    const A imag_part = A(2) * h * h * c1 * k1;
+
+    return std::polar(A(1), w * center) * std::complex<A>(real_part, imag_part);
+}
+
+template void FilonWeights<double>(double, double&, double&, double&);
+template void FilonWeights<long double>(long double, long double&, long double&, long double&);
+template std::complex<double> QuadraticOscillatoryIntegral<double>(const double[3], const double[3], double, double, double);
+template std::complex<long double> QuadraticOscillatoryIntegral<long double>(const long double[3], const long double[3], long double, long double, long double);
+
+template std::vector<HarmonicCoefficient<float>> IntegrateCoefficients<float>(QuadratureRule, EngineKind, const std::vector<float>&, float, float, const std::vector<int>&, SummationMode);
+template std::vector<HarmonicCoefficient<double>> IntegrateCoefficients<double>(QuadratureRule, EngineKind, const std::vector<double>&, double, double, const std::vector<int>&, SummationMode);
+template std::vector<HarmonicCoefficient<long double>> IntegrateCoefficients<long double>(QuadratureRule, EngineKind, const std::vector<long double>&, long double, long double, const std::vector<int>&, SummationMode);
+
+} // namespace fourier_sim
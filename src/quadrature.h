@@ -0,0 +1,43 @@
+#ifndef QUADRATURE_H_
+#define QUADRATURE_H_
+
+#include <complex>
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+enum class QuadratureRule {
+    kRiemann,   // Left sum over slices points, first order
+    kSimpson,   // Composite Simpson, fourth order for smooth f
+    kFilon,     // Filon-Simpson: f piecewise quadratic, oscillation integrated exactly
+    kPiecewise  // Filon on smooth segments split at detected jumps and kinks
+};
+
+const char* QuadratureName(QuadratureRule rule);
+
+// Number of samples f(range_start + i * T / panels) the rule needs for a slices budget.
+// Closed rules use an even panel count and include the right endpoint.
+int QuadratureSampleCount(QuadratureRule rule, int slices);
+
+// a_n, b_n from samples laid out as QuadratureSampleCount describes. Every rule is
+// reduced to trig sums over periodic samples, so any engine can evaluate them.
+// kPiecewise needs the function itself (see PiecewiseIntegrator), here it is plain Filon.
+// Instantiated for float, double and long double in quadrature.cpp.
+template <typename T>
+std::vector<HarmonicCoefficient<T>> IntegrateCoefficients(QuadratureRule rule, EngineKind engine, const std::vector<T>& samples, T range_start, T range_end, const std::vector<int>& indices, SummationMode summation = SummationMode::kNaive);
+
+// Filon-Simpson weights for theta = w h, series expansions below theta = 1/6.
+// Instantiated for double and long double.
+template <typename A>
+void FilonWeights(A theta, A& alpha, A& beta, A& gamma);
+
+// Exact integral over [lo, hi] of e^{i w x} times the quadratic through (x[k], f[k]).
+// The points need not be equally spaced nor lie inside [lo, hi]; this is the Filon
+// building block for non-uniform grids. Instantiated for double and long double.
+template <typename A>
+std::complex<A> QuadraticOscillatoryIntegral(const A x[3], const A f[3], A lo, A hi, A w);
+
+} // namespace fourier_sim
+
+#endif  // QUADRATURE_H_
@@ -0,0 +1,275 @@
+#include "series.h"
+#include "fft.h"
+#include "synthesis.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+
+    // Shared by every scalar type, series are built from several threads in batch jobs
+    std::atomic<std::uint64_t> next_version{1};
+
+    // Below one coefficient per this many indices a point costs less as a direct sum
+    const int kSparseRatio = 8;
+
+    // Relative slack, in units of T's epsilon, for accepting T / x_step as an integer grid size
+    const double kGridTolerance = 64.0;
+
+    // Dense grids above this size run as interleaved sub-grid FFTs that stay in cache;
+    // without a divisor of at least kMinSubgridPoints the full-size transform is used
+    const int kMaxSubgridPoints = 1 << 16;
+    const int kMinSubgridPoints = 1 << 10;
+
+    // M when the period is a whole number M of positive steps and the grid can run through
+    // the double FFT, else 0; long double grids keep the kernel for their extra bits
+    template <typename T, typename A>
+    int PeriodPoints(A period, T x_step) {
+        if (!(x_step > T(0)) || sizeof(T) > sizeof(double)) {
+            return 0;
+        }
+        const A points = period / static_cast<A>(x_step);
+        const A rounded = std::round(points);
+        const A tolerance = kGridTolerance * std::numeric_limits<T>::epsilon();
+        if (rounded < 1 || rounded > (1 << 30) || std::abs(points - rounded) > tolerance * points) {
+            return 0;
+        }
+        return static_cast<int>(rounded);
+    }
+
+    // cos is even and sin is odd, so harmonic -n is harmonic n with b negated. Every
+    // evaluation path works on the folded index, like the direct sums do implicitly.
+    template <typename T>
+    HarmonicCoefficient<T> FoldNegativeIndex(HarmonicCoefficient<T> c) {
+        if (c.index < 0) {
+            c.index = -c.index;
+            c.b = -c.b;
+        }
+        return c;
+    }
+
+    // (a_n - i b_n) e^{i n pi x_start / L} with a_0 halved, the bin value of one harmonic
+    template <typename T>
+    std::complex<double> GridSpectrum(const HarmonicCoefficient<T>& c, double shift) {
+        const double kTwoPi = 2 * static_cast<double>(kPiLong);
+        const double a = (c.index == 0) ? static_cast<double>(c.a) / 2 : static_cast<double>(c.a);
+        const double b = (c.index == 0) ? 0.0 : static_cast<double>(c.b);
+        return std::complex<double>(a, -b) * std::polar(1.0, std::fmod(c.index * shift, kTwoPi));
+    }
+} // namespace
+
+template <typename T>
+Series<T>::Series(std::vector<HarmonicCoefficient<T>> coefficients, T range_start, T range_end)
+    : coefficients_(std::move(coefficients)), range_start_(range_start), range_end_(range_end), 
+      version_(next_version.fetch_add(1, std::memory_order_relaxed)) {
+    for (HarmonicCoefficient<T>& c : coefficients_) {
+        c = FoldNegativeIndex(c);
+        max_index_ = std::max(max_index_, c.index);
+    }
+
+    sparse_ = static_cast<long long>(coefficients_.size()) * kSparseRatio < max_index_ + 1LL;
+    if (sparse_ || max_index_ < 0) {
+        return;
+    }
+
+    dense_a_.assign(max_index_ + 1, A(0));
+    dense_b_.assign(max_index_ + 1, A(0));
+    for (const HarmonicCoefficient<T>& c : coefficients_) {
+        dense_a_[c.index] += (c.index == 0) ? A(c.a) / 2 : A(c.a);
+        dense_b_[c.index] += (c.index == 0) ? A(0) : A(c.b);
+    }
+}
+
+template <typename T>
+T Series<T>::Evaluate(T x) const {
+    if (max_index_ < 0) {
+        return T(0);
+    }
+
+    const A L = (static_cast<A>(range_end_) - range_start_) / 2;
+    const A theta = static_cast<A>(kPiLong) * x / L;
+
+    if (sparse_) {
+        A sum = A(0);
+        for (const HarmonicCoefficient<T>& c : coefficients_) {
+            if (c.index == 0) {
+                sum += A(c.a) / 2;
+            } else {
+                sum += c.a * std::cos(c.index * theta) + c.b * std::sin(c.index * theta);
+            }
+        }
+        return static_cast<T>(sum);
+    }
+
+    // u_k = a_k + 2 cos(theta) u_{k+1} - u_{k+2}, likewise v for b; then
+    // sum a_k cos(k theta) = a_0 + u_1 cos(theta) - u_2 and sum b_k sin(k theta) = v_1 sin(theta)
+    const A c = std::cos(theta);
+    const A twice_c = 2 * c;
+    A u1 = A(0), u2 = A(0);
+    A v1 = A(0), v2 = A(0);
+    for (int k = max_index_; k >= 1; --k) {
+        const A u0 = dense_a_[k] + twice_c * u1 - u2;
+        const A v0 = dense_b_[k] + twice_c * v1 - v2;
+        u2 = u1;
+        u1 = u0;
+        v2 = v1;
+        v1 = v0;
+    }
+
+    return static_cast<T>(dense_a_[0] + u1 * c - u2 + v1 * std::sin(theta));
+}
+
+template <typename T>
+std::vector<T> Series<T>::Evaluate(const std::vector<T>& xs) const {
+    std::vector<T> out(xs.size());
+    for (size_t j = 0; j < xs.size(); ++j) {
+        out[j] = Evaluate(xs[j]);
+    }
+    return out;
+}
+
+template <typename T>
+std::vector<T> Series<T>::EvaluateGrid(T x_start, T x_step, int count) const {
+    if (count <= 0) {
+        return {};
+    }
+
+    const A period = static_cast<A>(range_end_) - range_start_;
+    const int points = PeriodPoints<T>(period, x_step);
+
+    // The FFT computes M points for O(M log M + N), the kernel costs O(count * N)
+    const double fft_cost = points * std::log2(std::max(points, 2)) + static_cast<double>(coefficients_.size());
+    const double kernel_cost = static_cast<double>(count) * coefficients_.size();
+    if (points > 0 && fft_cost < kernel_cost) {
+        return EvaluateGridFft(x_start, points, count);
+    }
+
+    std::vector<T> out(count);
+    SynthesizeSeries(coefficients_, static_cast<T>(period / 2), x_start, x_step, count, out.data());
+    return out;
+}
+
+template <typename T>
+std::vector<T> Series<T>::EvaluateGridFft(T x_start, int period_points, int count) const {
+    // On x_j = x_start + j T / M the phase n pi x_j / L is n pi x_start / L + 2 pi n j / M,
+    // so S(x_j) = Re sum_n C_n e^{2 pi i n j / M} with C_n = (a_n - i b_n) e^{i n pi x_start / L}.
+    // Large M is split into Q interleaved sub-grids j = r + Q s of P = M / Q points each,
+    // one cache-sized inverse FFT apiece: S(x_{r + Q s}) = Re sum_n C_n e^{2 pi i n r / M} e^{2 pi i n s / P}.
+    // Indices past P alias onto bin n mod P, which is exact on the sub-grid.
+    const int M = period_points;
+    const double kPi = static_cast<double>(kPiLong);
+    const double L = (static_cast<double>(range_end_) - range_start_) / 2;
+    const double shift = kPi * static_cast<double>(x_start) / L;
+
+    int P = M;
+    if (M > kMaxSubgridPoints) {
+        for (int d = kMaxSubgridPoints; d >= kMinSubgridPoints; --d) {
+            if (M % d == 0) {
+                P = d;
+                break;
+            }
+        }
+    }
+    const int Q = M / P;
+
+    std::vector<std::complex<double>> spectrum;
+    std::vector<int> index;
+    spectrum.reserve(coefficients_.size());
+    for (const HarmonicCoefficient<T>& c : coefficients_) {
+        spectrum.push_back(GridSpectrum(c, shift));
+        index.push_back(c.index);
+    }
+
+    std::shared_ptr<const FftPlan> plan = DefaultPlanCache().Acquire(P, FftKind::kInverse);
+    std::vector<std::complex<double>> bins(P);
+    std::vector<std::complex<double>> grid(P);
+    std::vector<T> out(count);
+
+    for (int r = 0; r < Q && r < count; ++r) {
+        std::fill(bins.begin(), bins.end(), std::complex<double>(0.0));
+        for (size_t k = 0; k < spectrum.size(); ++k) {
+            // n r mod M in integers keeps the sub-grid offset exact
+            const long long turn = (static_cast<long long>(index[k] % M) * r) % M;
+            bins[index[k] % P] += (r == 0) ? spectrum[k] : spectrum[k] * std::polar(1.0, 2 * kPi * turn / M);
+        }
+
+        // One-sided spectrum, the real part of the unscaled inverse is the series
+        plan->Execute(bins.data(), grid.data());
+        for (int s = 0, j = r; s < P && j < count; ++s, j += Q) {
+            out[j] = static_cast<T>(grid[s].real());
+        }
+    }
+
+    // Past one period the grid repeats
+    for (int j = M; j < count; ++j) {
+        out[j] = out[j - M];
+    }
+    return out;
+}
+
+template <typename T>
+GridSynthesizer<T>::GridSynthesizer(T range_start, T range_end, T x_start, T x_step, int count)
+    : half_period_((range_end - range_start) / T(2)), x_start_(x_start), x_step_(x_step), count_(std::max(count, 0)) {
+    using A = std::conditional_t<std::is_same_v<T, float>, double, T>;
+    const int points = PeriodPoints<T>(static_cast<A>(range_end) - range_start, x_step);
+
+    // Bins only pay off while the grid covers about a period, a short window of a
+    // finely divided period would hold far more bins than points
+    if (points > 0 && points <= count_) {
+        bins_.assign(points, std::complex<double>(0.0));
+    } else {
+        values_.assign(count_, T(0));
+    }
+}
+
+template <typename T>
+void GridSynthesizer<T>::Add(const std::vector<HarmonicCoefficient<T>>& coefficients) {
+    if (bins_.empty()) {
+        AccumulateSeries(coefficients, half_period_, x_start_, x_step_, count_, values_.data());
+        return;
+    }
+
+    const int M = static_cast<int>(bins_.size());
+    const double shift = static_cast<double>(kPiLong) * static_cast<double>(x_start_) / static_cast<double>(half_period_);
+    for (const HarmonicCoefficient<T>& c : coefficients) {
+        const HarmonicCoefficient<T> folded = FoldNegativeIndex(c);
+        bins_[folded.index % M] += GridSpectrum(folded, shift);
+    }
+}
+
+template <typename T>
+std::vector<T> GridSynthesizer<T>::Result() const {
+    if (bins_.empty()) {
+        return values_;
+    }
+
+    const int M = static_cast<int>(bins_.size());
+    std::vector<std::complex<double>> grid(M);
+    DefaultPlanCache().Acquire(M, FftKind::kInverse)->Execute(bins_.data(), grid.data());
+
+    std::vector<T> out(count_);
+    for (int j = 0; j < count_; ++j) {
+        out[j] = static_cast<T>(grid[j % M].real());
+    }
+    return out;
+}
+
+template <typename T>
+size_t GridSynthesizer<T>::MemoryBytes() const {
+    // Result() adds the transformed grid and the output on top
+    return bins_.capacity() * 2 * sizeof(std::complex<double>) + (values_.capacity() + count_) * sizeof(T);
+}
+
+template class Series<float>;
+template class Series<double>;
+template class Series<long double>;
+template class GridSynthesizer<float>;
+template class GridSynthesizer<double>;
+template class GridSynthesizer<long double>;
+
+} // namespace fourier_sim
@@ -0,0 +1,86 @@
+#ifndef SERIES_H_
+#define SERIES_H_
+
+#include <complex>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+// A truncated series a_0 / 2 + sum a_n cos(n pi x / L) + b_n sin(n pi x / L) over
+// [range_start, range_end], evaluated at any resolution independent of the grid the
+// coefficients came from. Immutable once built, so snapshots can be shared freely.
+// A negative index -n is stored as n with b negated, the same term since sin is odd.
+// Instantiated for float, double and long double in series.cpp.
+template <typename T>
+class Series {
+
+    public:
+        Series(std::vector<HarmonicCoefficient<T>> coefficients, T range_start, T range_end);
+
+        // Clenshaw recurrence over the dense coefficients, or a direct sum when the
+        // index set is much sparser than its largest index
+        T Evaluate(T x) const;
+        std::vector<T> Evaluate(const std::vector<T>& xs) const;
+
+        // out[j] = S(x_start + j * x_step). When T / x_step is an integer M the grid is
+        // one inverse FFT of size M (repeated periodically), else the blocked kernel.
+        std::vector<T> EvaluateGrid(T x_start, T x_step, int count) const;
+
+        const std::vector<HarmonicCoefficient<T>>& GetCoefficients() const { return coefficients_; }
+        T GetRangeStart() const { return range_start_; }
+        T GetRangeEnd() const { return range_end_; }
+        int GetMaxIndex() const { return max_index_; }
+
+        // Unique per built series, so a view can tell a new snapshot from the one it drew
+        std::uint64_t GetVersion() const { return version_; }
+
+    private:
+        using A = std::conditional_t<std::is_same_v<T, float>, double, T>;
+
+        std::vector<T> EvaluateGridFft(T x_start, int period_points, int count) const;
+
+        std::vector<HarmonicCoefficient<T>> coefficients_;
+        T range_start_;
+        T range_end_;
+        int max_index_ = -1;
+        std::uint64_t version_;
+
+        // a_n, b_n by index with duplicates merged and a_0 halved, for Clenshaw
+        std::vector<A> dense_a_;
+        std::vector<A> dense_b_;
+        bool sparse_ = false;
+
+};
+
+// Sums a series onto the grid x_start + j * x_step block by block of harmonics, for
+// series too long to hold at once. On a grid that divides the period each block only
+// adds into an M-bin spectrum and Result() runs one inverse FFT, otherwise every block
+// goes through the synthesis kernel. Memory is the grid plus at most M bins.
+template <typename T>
+class GridSynthesizer {
+
+    public:
+        GridSynthesizer(T range_start, T range_end, T x_start, T x_step, int count);
+
+        void Add(const std::vector<HarmonicCoefficient<T>>& coefficients);
+        std::vector<T> Result() const;
+
+        size_t MemoryBytes() const;
+
+    private:
+        T half_period_;
+        T x_start_;
+        T x_step_;
+        int count_;
+
+        std::vector<std::complex<double>> bins_;
+        std::vector<T> values_;
+
+};
+
+} // namespace fourier_sim
+
+#endif  // SERIES_H_
@@ -0,0 +1,162 @@
+#include "static_layer.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace ui {
+
+namespace {
+    // sf::Text pads every glyph quad by a pixel so smoothing does not cut the edges
+    const float kGlyphPadding = 1.f;
+
+    sf::Vertex MakeVertex(sf::Vector2f position, sf::Color color, sf::Vector2f tex_coords = {0.f, 0.f}) {
+        sf::Vertex vertex;
+        vertex.position = position;
+        vertex.color = color;
+        vertex.texCoords = tex_coords;
+        return vertex;
+    }
+} // namespace
+
+void StaticLayer::Clear() {
+    // Batches keep their capacity, a rebuild of the same scene does not allocate
+    fills_.clear();
+    lines_.clear();
+    for (auto& [key, vertices] : glyphs_) {
+        vertices.clear();
+    }
+}
+
+void StaticLayer::AddRectangle(sf::FloatRect rect, sf::Color color) {
+    const sf::Vector2f a = rect.position;
+    const sf::Vector2f b = rect.position + sf::Vector2f(rect.size.x, 0.f);
+    const sf::Vector2f c = rect.position + sf::Vector2f(0.f, rect.size.y);
+    const sf::Vector2f d = rect.position + rect.size;
+
+    for (const sf::Vector2f& corner : {a, b, c, c, b, d}) {
+        fills_.push_back(MakeVertex(corner, color));
+    }
+}
+
+void StaticLayer::AddLine(sf::Vector2f from, sf::Vector2f to, sf::Color color) {
+    lines_.push_back(MakeVertex(from, color));
+    lines_.push_back(MakeVertex(to, color));
+}
+
+sf::FloatRect StaticLayer::AddText(const sf::Font& font, const std::string& text, unsigned int size, sf::Color color,
+                                   const sf::Transform& transform, sf::Vector2f anchor) {
+    // Same layout as sf::Text: pen starts on the baseline one character size down
+    const float whitespace = font.getGlyph(U' ', size, false).advance;
+    const float line_spacing = font.getLineSpacing(size);
+
+    float x = 0.f;
+    float y = static_cast<float>(size);
+    float min_x = static_cast<float>(size);
+    float min_y = static_cast<float>(size);
+    float max_x = 0.f;
+    float max_y = 0.f;
+    std::uint32_t previous = 0;
+
+    scratch_.clear();
+    for (const char character : text) {
+        const std::uint32_t current = static_cast<unsigned char>(character);
+        if (current == U'\r') {
+            continue;
+        }
+
+        x += font.getKerning(previous, current, size, false);
+        previous = current;
+
+        if (current == U' ' || current == U'\t' || current == U'\n') {
+            min_x = std::min(min_x, x);
+            min_y = std::min(min_y, y);
+            if (current == U' ') {
+                x += whitespace;
+            } else if (current == U'\t') {
+                x += whitespace * 4;
+            } else {
+                y += line_spacing;
+                x = 0.f;
+            }
+            max_x = std::max(max_x, x);
+            max_y = std::max(max_y, y);
+            continue;
+        }
+
+        const sf::Glyph& glyph = font.getGlyph(current, size, false);
+        const float left = glyph.bounds.position.x - kGlyphPadding;
+        const float top = glyph.bounds.position.y - kGlyphPadding;
+        const float right = glyph.bounds.position.x + glyph.bounds.size.x + kGlyphPadding;
+        const float bottom = glyph.bounds.position.y + glyph.bounds.size.y + kGlyphPadding;
+
+        const float u1 = static_cast<float>(glyph.textureRect.position.x) - kGlyphPadding;
+        const float v1 = static_cast<float>(glyph.textureRect.position.y) - kGlyphPadding;
+        const float u2 = static_cast<float>(glyph.textureRect.position.x + glyph.textureRect.size.x) + kGlyphPadding;
+        const float v2 = static_cast<float>(glyph.textureRect.position.y + glyph.textureRect.size.y) + kGlyphPadding;
+
+        scratch_.push_back(MakeVertex({x + left, y + top}, color, {u1, v1}));
+        scratch_.push_back(MakeVertex({x + right, y + top}, color, {u2, v1}));
+        scratch_.push_back(MakeVertex({x + left, y + bottom}, color, {u1, v2}));
+        scratch_.push_back(MakeVertex({x + left, y + bottom}, color, {u1, v2}));
+        scratch_.push_back(MakeVertex({x + right, y + top}, color, {u2, v1}));
+        scratch_.push_back(MakeVertex({x + right, y + bottom}, color, {u2, v2}));
+
+        min_x = std::min(min_x, x + glyph.bounds.position.x);
+        max_x = std::max(max_x, x + glyph.bounds.position.x + glyph.bounds.size.x);
+        min_y = std::min(min_y, y + glyph.bounds.position.y);
+        max_y = std::max(max_y, y + glyph.bounds.position.y + glyph.bounds.size.y);
+
+        x += glyph.advance;
+    }
+
+    const sf::FloatRect bounds = text.empty() ? sf::FloatRect() : sf::FloatRect({min_x, min_y}, {max_x - min_x, max_y - min_y});
+
+    // Origin like sf::Text's setOrigin, then the caller's transform
+    sf::Transform placement = transform;
+    placement.translate({-anchor.x * bounds.size.x, -anchor.y * bounds.size.y});
+
+    std::vector<sf::Vertex>& batch = glyphs_[{&font, size}];
+    for (sf::Vertex vertex : scratch_) {
+        vertex.position = placement.transformPoint(vertex.position);
+        batch.push_back(vertex);
+    }
+
+    return bounds;
+}
+
+void StaticLayer::AddText(const sf::Text& text) {
+    // The transform already holds the text's origin
+    AddText(text.getFont(), text.getString().toAnsiString(), text.getCharacterSize(), text.getFillColor(), text.getTransform());
+}
+
+void StaticLayer::Draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (!fills_.empty()) {
+        target.draw(fills_.data(), fills_.size(), sf::PrimitiveType::Triangles, states);
+    }
+    if (!lines_.empty()) {
+        target.draw(lines_.data(), lines_.size(), sf::PrimitiveType::Lines, states);
+    }
+
+    // Texture fetched at draw time, the font grows its page as new glyphs are loaded
+    for (const auto& [key, vertices] : glyphs_) {
+        if (vertices.empty()) {
+            continue;
+        }
+        sf::RenderStates glyph_states = states;
+        glyph_states.texture = &key.first->getTexture(key.second);
+        target.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Triangles, glyph_states);
+    }
+}
+
+bool StaticLayer::IsEmpty() const {
+    return GetBatchCount() == 0;
+}
+
+size_t StaticLayer::GetBatchCount() const {
+    size_t count = (fills_.empty() ? 0 : 1) + (lines_.empty() ? 0 : 1);
+    for (const auto& [key, vertices] : glyphs_) {
+        count += vertices.empty() ? 0 : 1;
+    }
+    return count;
+}
+
+} // namespace ui
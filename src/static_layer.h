@@ -0,0 +1,52 @@
+#ifndef STATIC_LAYER_H_
+#define STATIC_LAYER_H_
+
+#include <SFML/Graphics.hpp>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ui {
+
+// Geometry that changes rarely (panel backgrounds, axes, ticks, fixed labels) baked
+// into a few vertex batches: one of filled rectangles, one of line segments and one
+// of glyph quads per font and character size, since each size has its own font
+// texture. Draw issues one call per batch however many items were added, and
+// nothing is laid out again until the owner clears and rebuilds the layer.
+class StaticLayer {
+    public:
+        void Clear();
+
+        void AddRectangle(sf::FloatRect rect, sf::Color color);
+        void AddLine(sf::Vector2f from, sf::Vector2f to, sf::Color color);
+
+        // Glyph quads of text laid out as sf::Text lays it out, with the origin at
+        // anchor times the size of the local bounds and transform applied after.
+        // Returns the local bounds.
+        sf::FloatRect AddText(const sf::Font& font, const std::string& text, unsigned int size, sf::Color color,
+                              const sf::Transform& transform, sf::Vector2f anchor = {0.f, 0.f});
+
+        // A text already set up for drawing, baked with its own transform
+        void AddText(const sf::Text& text);
+
+        void Draw(sf::RenderTarget& target, sf::RenderStates states = sf::RenderStates::Default) const;
+
+        bool IsEmpty() const;
+        size_t GetBatchCount() const;
+
+    private:
+        using GlyphKey = std::pair<const sf::Font*, unsigned int>;
+
+        // sf::PrimitiveType::Triangles and sf::PrimitiveType::Lines
+        std::vector<sf::Vertex> fills_;
+        std::vector<sf::Vertex> lines_;
+        std::map<GlyphKey, std::vector<sf::Vertex>> glyphs_;
+
+        // Kept across rebuilds so a relayout does not reallocate
+        std::vector<sf::Vertex> scratch_;
+};
+
+} // namespace ui
+
+#endif  // STATIC_LAYER_H_
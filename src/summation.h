@@ -0,0 +1,68 @@
+#ifndef SUMMATION_H_
+#define SUMMATION_H_
+
+#include <cmath>
+#include <cstddef>
+
+namespace fourier_sim {
+
+enum class SummationMode {
+    kNaive,
+    kNeumaier,
+    kPairwise
+};
+
+// Inline, so the header-only module needs no translation unit to link against
+inline const char* SummationName(SummationMode mode) {
+    switch (mode) {
+        case SummationMode::kNaive: return "naive";
+        case SummationMode::kNeumaier: return "neumaier";
+        case SummationMode::kPairwise: return "pairwise";
+    }
+    return "unknown";
+}
+
+// Kahan-Babuska-Neumaier: carries the low-order bits lost by each addition,
+// error stays O(eps) instead of O(n eps). Breaks under -ffast-math.
+template <typename T>
+class NeumaierSum {
+
+    public:
+        void Add(T value) {
+            T t = sum_ + value;
+            if (std::abs(sum_) >= std::abs(value)) {
+                compensation_ += (sum_ - t) + value;
+            } else {
+                compensation_ += (value - t) + sum_;
+            }
+            sum_ = t;
+        }
+
+        T Result() const { return sum_ + compensation_; }
+
+    private:
+        T sum_ = T(0);
+        T compensation_ = T(0);
+
+};
+
+// Naive sums on blocks of kPairwiseBlock, combined as a binary tree: O(log n eps) error
+template <typename T>
+T PairwiseSum(const T* values, size_t count) {
+    const size_t kPairwiseBlock = 32;
+
+    if (count <= kPairwiseBlock) {
+        T sum = T(0);
+        for (size_t i = 0; i < count; ++i) {
+            sum += values[i];
+        }
+        return sum;
+    }
+
+    size_t half = count / 2;
+    return PairwiseSum(values, half) + PairwiseSum(values + half, count - half);
+}
+
+} // namespace fourier_sim
+
+#endif  // SUMMATION_H_
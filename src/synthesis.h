@@ -0,0 +1,26 @@
+#ifndef SYNTHESIS_H_
+#define SYNTHESIS_H_
+
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+// out[j] = a_0 / 2 + sum_n a_n cos(n pi x_j / L) + b_n sin(n pi x_j / L) at
+// x_j = x_start + j * x_step, for any index set.
+//
+// Tiled over x-blocks and harmonic-blocks so the block's coefficients, phasors and
+// outputs stay in L1. Each harmonic's phasor is seeded with one sincos per x-block
+// and then advanced by a fixed rotation e^{i n pi x_step / L}, which also bounds the
+// recurrence drift to one block. Instantiated for float, double and long double.
+template <typename T>
+void SynthesizeSeries(const std::vector<HarmonicCoefficient<T>>& coefficients, T half_period, T x_start, T x_step, int count, T* out);
+
+// Adds the terms to out instead of overwriting it, so a series can be summed block by
+// block of harmonics without keeping the earlier blocks
+template <typename T>
+void AccumulateSeries(const std::vector<HarmonicCoefficient<T>>& coefficients, T half_period, T x_start, T x_step, int count, T* out);
+
+} // namespace fourier_sim
+
+#endif  // SYNTHESIS_H_
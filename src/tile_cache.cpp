@@ -0,0 +1,261 @@
+#include "tile_cache.h"
+#include <algorithm>
+#include <cmath>
+
+namespace fourier_sim {
+
+namespace {
+    // Zoom bounds in powers of two around the base step
+    const int kMinLevel = -24;
+    const int kMaxLevel = 40;
+
+    // Coarser levels searched for a stand-in while a tile is pending
+    const int kFallbackLevels = 6;
+
+    // Requests past this are dropped oldest first, they belong to views long gone
+    const size_t kMaxQueued = 256;
+} // namespace
+
+template <typename T>
+TileCache<T>::TileCache(T base_step, size_t max_tiles) : base_step_(base_step), max_tiles_(std::max<size_t>(max_tiles, 1)) {
+    worker_ = std::thread(&TileCache::WorkerLoop, this);
+}
+
+template <typename T>
+TileCache<T>::~TileCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+template <typename T>
+void TileCache<T>::SetSeries(std::shared_ptr<const Series<T>> series) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (series == series_) {
+        return;
+    }
+
+    series_ = std::move(series);
+    ++generation_;
+    tiles_.clear();
+    lru_.clear();
+    queue_.clear();
+    requested_.clear();
+}
+
+template <typename T>
+bool TileCache<T>::HasSeries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return series_ != nullptr;
+}
+
+template <typename T>
+int TileCache<T>::LevelFor(T units_per_sample) const {
+    if (!(units_per_sample > T(0))) {
+        return kMaxLevel;
+    }
+    const double level = std::ceil(std::log2(static_cast<double>(base_step_) / static_cast<double>(units_per_sample)) - 1e-9);
+    return static_cast<int>(std::clamp(level, static_cast<double>(kMinLevel), static_cast<double>(kMaxLevel)));
+}
+
+template <typename T>
+T TileCache<T>::StepAt(int level) const {
+    return static_cast<T>(std::ldexp(static_cast<long double>(base_step_), -level));
+}
+
+template <typename T>
+void TileCache<T>::Collect(T x_begin, T x_end, int level, std::vector<T>& xs, std::vector<T>& ys) {
+    xs.clear();
+    ys.clear();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!series_ || !(x_end > x_begin)) {
+        return;
+    }
+
+    level = std::clamp(level, kMinLevel, kMaxLevel);
+    const T width = StepAt(level) * kTileSamples;
+    const long long first = static_cast<long long>(std::floor(x_begin / width));
+    const long long last = static_cast<long long>(std::floor(x_end / width));
+
+    for (long long index = first; index <= last; ++index) {
+        const T lo = std::max(x_begin, static_cast<T>(index * width));
+        const T hi = std::min(x_end, static_cast<T>((index + 1) * width));
+        const Key key = MakeKey(level, index);
+
+        if (const Tile* tile = Find(key)) {
+            Append(*tile, level, index, lo, hi, xs, ys);
+            continue;
+        }
+
+        // Tiles are aligned at multiples of their width, so the coarse tile holding lo
+        // holds the whole span
+        bool covered = false;
+        for (int coarse = level - 1; coarse >= std::max(level - kFallbackLevels, kMinLevel) && !covered; --coarse) {
+            const long long coarse_index = static_cast<long long>(std::floor(lo / (StepAt(coarse) * kTileSamples)));
+            if (const Tile* tile = Find(MakeKey(coarse, coarse_index))) {
+                Append(*tile, coarse, coarse_index, lo, hi, xs, ys);
+                covered = true;
+            }
+        }
+
+        if (covered) {
+            Request(key);
+            continue;
+        }
+
+        // Nothing to stand in, computed here; the worker keeps going meanwhile
+        std::shared_ptr<const Series<T>> series = series_;
+        lock.unlock();
+        std::vector<T> values = ComputeTile(*series, level, index);
+        lock.lock();
+
+        if (series != series_) {
+            return;
+        }
+        Insert(key, std::move(values));
+        Append(*Find(key), level, index, lo, hi, xs, ys);
+    }
+}
+
+template <typename T>
+bool TileCache<T>::TakeUpdates() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool updated = updated_;
+    updated_ = false;
+    return updated;
+}
+
+template <typename T>
+size_t TileCache<T>::GetTileCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tiles_.size();
+}
+
+template <typename T>
+size_t TileCache<T>::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requested_.size();
+}
+
+template <typename T>
+typename TileCache<T>::Key TileCache<T>::MakeKey(int level, long long index) {
+    // Level in the top byte, the index in the 56 bits below
+    return (static_cast<Key>(level + 128) << 56) | (static_cast<Key>(index) & ((Key(1) << 56) - 1));
+}
+
+template <typename T>
+int TileCache<T>::KeyLevel(Key key) {
+    return static_cast<int>(key >> 56) - 128;
+}
+
+template <typename T>
+long long TileCache<T>::KeyIndex(Key key) {
+    // Sign-extend the 56 bit index
+    const long long index = static_cast<long long>(key << 8);
+    return index >> 8;
+}
+
+template <typename T>
+std::vector<T> TileCache<T>::ComputeTile(const Series<T>& series, int level, long long index) const {
+    const T step = StepAt(level);
+    const T x_start = static_cast<T>(static_cast<long double>(index) * kTileSamples * step);
+    return series.EvaluateGrid(x_start, step, kTileSamples + 1);
+}
+
+template <typename T>
+const typename TileCache<T>::Tile* TileCache<T>::Find(Key key) {
+    auto it = tiles_.find(key);
+    if (it == tiles_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return &it->second;
+}
+
+template <typename T>
+void TileCache<T>::Insert(Key key, std::vector<T> values) {
+    auto it = tiles_.find(key);
+    if (it != tiles_.end()) {
+        it->second.values = std::move(values);
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        return;
+    }
+
+    lru_.push_front(key);
+    tiles_[key] = {std::move(values), lru_.begin()};
+
+    while (tiles_.size() > max_tiles_) {
+        tiles_.erase(lru_.back());
+        lru_.pop_back();
+    }
+}
+
+template <typename T>
+void TileCache<T>::Request(Key key) {
+    if (!requested_.insert(key).second) {
+        return;
+    }
+
+    queue_.push_front(key);
+    while (queue_.size() > kMaxQueued) {
+        requested_.erase(queue_.back());
+        queue_.pop_back();
+    }
+    wake_.notify_one();
+}
+
+template <typename T>
+void TileCache<T>::Append(const Tile& tile, int level, long long index, T lo, T hi, std::vector<T>& xs, std::vector<T>& ys) const {
+    // One sample past each end of [lo, hi] so the strip reaches the span edges
+    const T step = StepAt(level);
+    const T x_start = static_cast<T>(static_cast<long double>(index) * kTileSamples * step);
+    const int j_lo = std::clamp(static_cast<int>(std::floor((lo - x_start) / step)), 0, kTileSamples);
+    const int j_hi = std::clamp(static_cast<int>(std::ceil((hi - x_start) / step)), 0, kTileSamples);
+
+    for (int j = j_lo; j <= j_hi; ++j) {
+        const T x = x_start + j * step;
+        if (!xs.empty() && !(x > xs.back())) {
+            continue;
+        }
+        xs.push_back(x);
+        ys.push_back(tile.values[j]);
+    }
+}
+
+template <typename T>
+void TileCache<T>::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) {
+            return;
+        }
+
+        const Key key = queue_.front();
+        queue_.pop_front();
+        std::shared_ptr<const Series<T>> series = series_;
+        const std::uint64_t generation = generation_;
+
+        lock.unlock();
+        std::vector<T> values = ComputeTile(*series, KeyLevel(key), KeyIndex(key));
+        lock.lock();
+
+        // A new series cleared the request, the values belong to the old one
+        if (generation != generation_) {
+            continue;
+        }
+        requested_.erase(key);
+        Insert(key, std::move(values));
+        updated_ = true;
+    }
+}
+
+template class TileCache<float>;
+template class TileCache<double>;
+template class TileCache<long double>;
+
+} // namespace fourier_sim
@@ -0,0 +1,101 @@
+#ifndef TILE_CACHE_H_
+#define TILE_CACHE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "series.h"
+
+namespace fourier_sim {
+
+// Series values on a multi-resolution grid for a zoomable plot. Level l samples every
+// base_step / 2^l, in tiles of kTileSamples steps that start at multiples of the tile
+// width, so a pan only touches the tiles it exposes and a zoom step changes level by one.
+//
+// Tiles missing at the requested level are computed by a background thread while the
+// finest ready coarser level stands in; a span with no level at all is computed on the
+// caller's thread so nothing is left blank. Tiles are evicted least recently used first.
+// Instantiated for float, double and long double in tile_cache.cpp.
+template <typename T>
+class TileCache {
+
+    public:
+        static constexpr int kTileSamples = 256;
+
+        explicit TileCache(T base_step, size_t max_tiles = 4096);
+        ~TileCache();
+
+        TileCache(const TileCache&) = delete;
+        TileCache& operator=(const TileCache&) = delete;
+
+        // A new series drops every tile and pending job of the old one
+        void SetSeries(std::shared_ptr<const Series<T>> series);
+        bool HasSeries() const;
+
+        // Coarsest level whose step is at most units_per_sample
+        int LevelFor(T units_per_sample) const;
+        T StepAt(int level) const;
+
+        // Increasing x and S(x) covering [x_begin, x_end], at level where ready
+        void Collect(T x_begin, T x_end, int level, std::vector<T>& xs, std::vector<T>& ys);
+
+        // True once after the background thread finished tiles, time to redraw
+        bool TakeUpdates();
+
+        size_t GetTileCount() const;
+        size_t GetPendingCount() const;
+
+    private:
+        using Key = std::uint64_t;
+
+        struct Tile {
+            std::vector<T> values;
+            std::list<Key>::iterator lru_position;
+        };
+
+        static Key MakeKey(int level, long long index);
+        static int KeyLevel(Key key);
+        static long long KeyIndex(Key key);
+
+        std::vector<T> ComputeTile(const Series<T>& series, int level, long long index) const;
+
+        // Callers hold mutex_
+        const Tile* Find(Key key);
+        void Insert(Key key, std::vector<T> values);
+        void Request(Key key);
+        void Append(const Tile& tile, int level, long long index, T lo, T hi, std::vector<T>& xs, std::vector<T>& ys) const;
+
+        void WorkerLoop();
+
+        T base_step_;
+        size_t max_tiles_;
+
+        std::shared_ptr<const Series<T>> series_;
+        std::uint64_t generation_ = 0;
+
+        // Front is the most recently used tile
+        std::list<Key> lru_;
+        std::unordered_map<Key, Tile> tiles_;
+
+        // Newest requests first, the view the user looks at now beats one panned past
+        std::deque<Key> queue_;
+        std::unordered_set<Key> requested_;
+        bool updated_ = false;
+        bool stop_ = false;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        std::thread worker_;
+
+};
+
+} // namespace fourier_sim
+
+#endif  // TILE_CACHE_H_
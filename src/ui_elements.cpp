@@ -1,8 +1,42 @@
 #include "ui_elements.h"
 #include <algorithm>
+#include <cmath>
+#include <complex>
 
 namespace ui{
 
+    namespace {
+        const double kPi = 3.141592653589793238462643383279502884;
+
+        // Stacked baselines are this many lanes apart at most in amplitude, neighbours may overlap
+        const float kStackedLanes = 4.f;
+
+        // Spectrum colours: stems, min to max bars, phase bars and the axes
+        const sf::Color kStemColor(70, 110, 160);
+        const sf::Color kAmplitudeColor(120, 200, 255);
+        const sf::Color kPhaseColor(255, 170, 60);
+        const sf::Color kSpectrumAxisColor(90, 90, 90);
+
+        // Phases of coefficients this far below the peak are rounding noise and not drawn
+        const double kPhaseFloor = 1e-6;
+
+        // Fully saturated colour at hue degrees in [0, 360)
+        sf::Color HueColor(float hue, std::uint8_t alpha) {
+            const float h = std::fmod(hue, 360.f) / 60.f;
+            const float x = 1.f - std::abs(std::fmod(h, 2.f) - 1.f);
+            float r = 0.f, g = 0.f, b = 0.f;
+            switch (static_cast<int>(h)) {
+                case 0: r = 1.f; g = x; break;
+                case 1: r = x; g = 1.f; break;
+                case 2: g = 1.f; b = x; break;
+                case 3: g = x; b = 1.f; break;
+                case 4: r = x; b = 1.f; break;
+                default: r = 1.f; b = x; break;
+            }
+            return sf::Color(static_cast<std::uint8_t>(255.f * r), static_cast<std::uint8_t>(255.f * g), static_cast<std::uint8_t>(255.f * b), alpha);
+        }
+    } // namespace
+
     void setupText(sf::Text& t, unsigned int size, sf::Vector2f pos) {
         t.setCharacterSize(size);
         t.setFillColor(sf::Color::White);
@@ -45,7 +79,10 @@ namespace ui{
             float track_right = track_left + track_.getSize().x;
             new_x = std::clamp(new_x, track_left, track_right);
 
-            handle_.setPosition({new_x, handle_.getPosition().y});
+            if (new_x != handle_.getPosition().x) {
+                handle_.setPosition({new_x, handle_.getPosition().y});
+                dirty_ = true;
+            }
         }
     }
 
@@ -58,13 +95,20 @@ namespace ui{
         return min_value_ + percentage * (max_value_ - min_value_);
     }
 
-    void Slider::Draw(sf::RenderWindow& window) const {
-        window.draw(track_);
-        window.draw(handle_);
+    void Slider::Draw(sf::RenderTarget& target) const {
+        target.draw(track_);
+        target.draw(handle_);
     }
 
     void Slider::ResetValue() {
         handle_.setPosition({track_.getPosition().x, handle_.getPosition().y});
+        dirty_ = true;
+    }
+
+    sf::FloatRect Slider::GetBounds() const {
+        const float radius = handle_.getRadius();
+        const sf::Vector2f track_position = track_.getPosition();
+        return sf::FloatRect({track_position.x - radius, handle_.getPosition().y - radius}, {track_.getSize().x + 2.f * radius, 2.f * radius});
     }
 
     Panel::Panel(sf::Vector2f position, sf::Vector2f size, sf::Color color) {
@@ -73,8 +117,12 @@ namespace ui{
         background_.setPosition(position);
     }
 
-    void Panel::Draw(sf::RenderWindow& window) const {
-        window.draw(background_);
+    void Panel::Draw(sf::RenderTarget& target) const {
+        target.draw(background_);
+    }
+
+    void Panel::Bake(StaticLayer& layer) const {
+        layer.AddRectangle(background_.getGlobalBounds(), background_.getFillColor());
     }
 
     TextBox::TextBox(sf::Vector2f position, sf::Vector2f size, int text_size, const sf::Font& font, sf::Color color) : display_text_(font) {
@@ -95,6 +143,7 @@ namespace ui{
         sf::Vector2f mouse_pos = window.mapPixelToCoords(sf::Mouse::getPosition(window));
 
         if (event.is<sf::Event::MouseButtonPressed>()){
+            dirty_ = dirty_ || (box_.getGlobalBounds().contains(mouse_pos) != is_focused_);
             if (box_.getGlobalBounds().contains(mouse_pos)) {
                 is_focused_ = true;
                 box_.setFillColor(kColorFocused);
@@ -124,15 +173,16 @@ namespace ui{
                         content_ += entered;
                     }
                     display_text_.setString(content_);
+                    dirty_ = true;
                 }
             }
 
         }
     }
 
-    void TextBox::Draw(sf::RenderWindow& window) const {
-        window.draw(box_);
-        window.draw(display_text_);
+    void TextBox::Draw(sf::RenderTarget& target) const {
+        target.draw(box_);
+        target.draw(display_text_);
     }
 
     std::string TextBox::GetText() const {
@@ -142,10 +192,11 @@ namespace ui{
     void TextBox::SetText(const std::string& text) {
         content_ = text;
         display_text_.setString(content_);
+        dirty_ = true;
     }
 
-    HarmonicScreen::HarmonicScreen(sf::Vector2f position, sf::Vector2f size, std::vector<std::function<float(float)>> harmonics, sf::Color color): 
-            position_(position), size_(size), harmonics_(harmonics) {
+    HarmonicScreen::HarmonicScreen(sf::Vector2f position, sf::Vector2f size, sf::Color color): 
+            position_(position), size_(size) {
 
         background_.setFillColor(color);
         background_.setSize(size);
@@ -178,39 +229,57 @@ namespace ui{
             grid_lines_.push_back(tickDown); 
 
         }
+
+        // One vertex per pixel column, allocated once and refilled on every update
+        func_vertices_.resize(static_cast<size_t>(std::floor(size.x)) + 1);
+        for (sf::Vertex& vertex : func_vertices_) {
+            vertex.color = sf::Color::Magenta;
+        }
     }
 
-    std::vector<sf::Vertex> HarmonicScreen::CalculateFunctionVertices(std::function<float(float)> func) 
-    {
-        std::vector<sf::Vertex> vertices;
-        
+    void HarmonicScreen::UpdateFunctionVertices() {
+        const std::uint64_t version = series_ ? series_->GetVersion() : 0;
+        if (version == drawn_version_ && current_harmonic_index_ == drawn_index_) {
+            return;
+        }
+        drawn_version_ = version;
+        drawn_index_ = current_harmonic_index_;
+        dirty_ = true;
+
+        const int count = series_ ? static_cast<int>(series_->GetCoefficients().size()) : 0;
+        curve_visible_ = current_harmonic_index_ >= 0 && current_harmonic_index_ < count;
+        if (!curve_visible_) {
+            return;
+        }
+
+        const fourier_sim::HarmonicCoefficient<float>& c = series_->GetCoefficients()[current_harmonic_index_];
+        const double L = (static_cast<double>(series_->GetRangeEnd()) - series_->GetRangeStart()) / 2.0;
+
         float centerY = position_.y + (size_.y / 2.0f);
         float verticalScale = size_.y / 2.0f;
 
-        for (float x_local = 0.0f; x_local <= size_.x; x_local += 1.0f) {
-            float x_math = (x_local / size_.x) * math_range_x_;
+        for (size_t i = 0; i < func_vertices_.size(); ++i) {
+            const float x_local = static_cast<float>(i);
+            const double x_math = (x_local / size_.x) * math_range_x_;
 
-            float y_math = func(x_math);
-            
-            float final_x = position_.x + x_local;
-            float final_y = centerY - (y_math * verticalScale);
+            // Phase in double, n pi x / L is far past float's exact range for high harmonics
+            float y_math = c.a / 2.0f;
+            if (c.index != 0) {
+                const double angle = c.index * kPi * x_math / L;
+                y_math = static_cast<float>(c.a * std::cos(angle) + c.b * std::sin(angle));
+            }
 
-            sf::Vertex point;
-            point.position = {final_x, final_y};
-            point.color = sf::Color::Magenta;
-            vertices.push_back(point);
+            func_vertices_[i].position = {position_.x + x_local, centerY - (y_math * verticalScale)};
         }
-
-        return vertices;
     }
 
-    void HarmonicScreen::Draw(sf::RenderWindow& window) const {
+    void HarmonicScreen::Draw(sf::RenderTarget& target) const {
         float kWidth = 800;
         float kHeight = 800;
 
-        window.draw(background_);
+        target.draw(background_);
 
-        sf::View vistaOriginal = window.getView();
+        sf::View vistaOriginal = target.getView();
         sf::View screen;
 
         // Size of the object
@@ -222,38 +291,279 @@ namespace ui{
         // Position and Size (%)
         screen.setViewport(sf::FloatRect({position_.x / kWidth, (abs(position_.y) + size_.y) / kHeight}, {size_.x / kWidth, size_.y / kHeight}));
 
-        window.setView(screen);
+        // A partial repaint keeps its clip region
+        screen.setScissor(vistaOriginal.getScissor());
+
+        target.setView(screen);
 
-        window.draw(line_vertices_.data(), line_vertices_.size(), sf::PrimitiveType::Lines);
-        window.draw(grid_lines_.data(), grid_lines_.size(), sf::PrimitiveType::Lines);
+        target.draw(line_vertices_.data(), line_vertices_.size(), sf::PrimitiveType::Lines);
+        target.draw(grid_lines_.data(), grid_lines_.size(), sf::PrimitiveType::Lines);
 
-        if (!func_vertices_.empty()) {
-            window.draw(func_vertices_.data(), func_vertices_.size(), sf::PrimitiveType::LineStrip);
+        if (view_ == HarmonicView::kLatest) {
+            if (curve_visible_) {
+                target.draw(func_vertices_.data(), func_vertices_.size(), sf::PrimitiveType::LineStrip);
+            }
+        } else if (!band_vertices_.empty()) {
+            target.draw(band_vertices_.data(), band_vertices_.size(), sf::PrimitiveType::Lines);
         }
 
-        window.setView(vistaOriginal);
+        target.setView(vistaOriginal);
     }
 
     void HarmonicScreen::UpdateHarmonicIndex(int index){
-        if (index >= 0 && index < harmonics_.size()) {
+        const int count = series_ ? static_cast<int>(series_->GetCoefficients().size()) : 0;
+        if (index >= 0 && index < count) {
             current_harmonic_index_ = index;
-            auto target_func = harmonics_[current_harmonic_index_];
-            func_vertices_ = CalculateFunctionVertices(target_func);
+            Refresh();
         }
 
     }
 
-    void HarmonicScreen::SetHarmonics(const std::vector<std::function<float(float)>>& new_harmonics) {
-        harmonics_ = new_harmonics;
+    void HarmonicScreen::SetSeries(std::shared_ptr<const fourier_sim::Series<float>> series, int index) {
+        series_ = std::move(series);
 
-        if (current_harmonic_index_ >= harmonics_.size()) {
-            current_harmonic_index_ = static_cast<int>(harmonics_.size()) - 1;
+        const int count = series_ ? static_cast<int>(series_->GetCoefficients().size()) : 0;
+        if (index >= 0 && index < count) {
+            current_harmonic_index_ = index;
+        } else if (current_harmonic_index_ >= count) {
+            current_harmonic_index_ = count - 1;
         }
 
-        if (!harmonics_.empty() && current_harmonic_index_ >= 0) {
-            func_vertices_ = CalculateFunctionVertices(harmonics_[current_harmonic_index_]);
+        Refresh();
+    }
+
+    void HarmonicScreen::SetView(HarmonicView view) {
+        if (view == view_) {
+            return;
+        }
+        view_ = view;
+        band_stale_ = true;
+        dirty_ = true;
+        Refresh();
+    }
+
+    void HarmonicScreen::Refresh() {
+        if (view_ == HarmonicView::kLatest) {
+            UpdateFunctionVertices();
         } else {
-            func_vertices_.clear();
+            UpdateBandVertices();
+        }
+    }
+
+    void HarmonicScreen::UpdateBandVertices() {
+        const std::uint64_t version = series_ ? series_->GetVersion() : 0;
+        if (version == band_version_ && !band_stale_) {
+            return;
+        }
+        band_version_ = version;
+        band_stale_ = false;
+        dirty_ = true;
+
+        // Capacity stays, a band of the same size is refilled without allocating
+        band_vertices_.clear();
+        const int size = series_ ? static_cast<int>(series_->GetCoefficients().size()) : 0;
+        const int count = std::min(kBand, size);
+        const int columns = static_cast<int>(func_vertices_.size());
+        if (count <= 0 || columns < 2) {
+            return;
+        }
+
+        const fourier_sim::HarmonicCoefficient<float>* coefficients = series_->GetCoefficients().data();
+        const double L = (static_cast<double>(series_->GetRangeEnd()) - series_->GetRangeStart()) / 2.0;
+
+        double peak = 0.0;
+        for (int k = 0; k < count; ++k) {
+            const fourier_sim::HarmonicCoefficient<float>& c = coefficients[k];
+            peak = std::max(peak, (c.index == 0) ? std::abs(c.a / 2.0) : std::hypot(static_cast<double>(c.a), static_cast<double>(c.b)));
+        }
+        if (!(peak > 0.0)) {
+            peak = 1.0;
+        }
+
+        // Overlay fills half the height with the band's peak, stacked lanes split the height
+        const float centerY = position_.y + (size_.y / 2.0f);
+        const float lane = size_.y / static_cast<float>(count + 1);
+        const double scale = ((view_ == HarmonicView::kOverlay) ? size_.y / 2.0f : std::min(size_.y / 2.0f, kStackedLanes * lane)) / peak;
+
+        // Dense overlays are translucent so the envelope shows through
+        const std::uint8_t alpha = static_cast<std::uint8_t>(std::clamp(255.f * 32.f / count, 64.f, 255.f));
+
+        band_vertices_.resize(static_cast<size_t>(count) * (columns - 1) * 2);
+        sf::Vertex* out = band_vertices_.data();
+        const double x_step = math_range_x_ / size_.x;
+
+        for (int k = 0; k < count; ++k) {
+            const fourier_sim::HarmonicCoefficient<float>& c = coefficients[k];
+            const sf::Color color = HueColor(300.f * k / std::max(count - 1, 1), alpha);
+            const float baseline = (view_ == HarmonicView::kStacked) ? position_.y + lane * (k + 1) : centerY;
+
+            // e^{i n pi x / L} from x = 0, advanced a column at a time: one sincos per
+            // harmonic and the drift over a few hundred steps stays far below a pixel
+            const std::complex<double> step = std::polar(1.0, c.index * kPi * x_step / L);
+            std::complex<double> phasor(1.0, 0.0);
+
+            sf::Vector2f previous;
+            for (int j = 0; j < columns; ++j) {
+                const double value = (c.index == 0) ? c.a / 2.0 : c.a * phasor.real() + c.b * phasor.imag();
+                const sf::Vector2f point = {position_.x + static_cast<float>(j), baseline - static_cast<float>(value * scale)};
+                if (j > 0) {
+                    out->position = previous;
+                    out->color = color;
+                    ++out;
+                    out->position = point;
+                    out->color = color;
+                    ++out;
+                }
+                previous = point;
+                phasor *= step;
+            }
+        }
+    }
+
+    SpectrumScreen::SpectrumScreen(sf::Vector2f position, sf::Vector2f size, sf::Color color) : position_(position), size_(size) {
+        background_.setFillColor(color);
+        background_.setOutlineColor(sf::Color(90, 90, 90));
+        background_.setOutlineThickness(1.f);
+        background_.setSize(size);
+        background_.setPosition(position);
+
+        const size_t columns = static_cast<size_t>(std::max(size.x, 1.f));
+        amplitude_min_.resize(columns);
+        amplitude_max_.resize(columns);
+        phase_min_.resize(columns);
+        phase_max_.resize(columns);
+    }
+
+    void SpectrumScreen::Draw(sf::RenderTarget& target) const {
+        if (!visible_) {
+            return;
+        }
+        target.draw(background_);
+        if (!vertices_.empty()) {
+            target.draw(vertices_.data(), vertices_.size(), sf::PrimitiveType::Lines);
+        }
+    }
+
+    void SpectrumScreen::SetSeries(std::shared_ptr<const fourier_sim::Series<float>> series) {
+        series_ = std::move(series);
+        UpdateVertices();
+    }
+
+    void SpectrumScreen::SetScale(SpectrumScale scale) {
+        if (scale == scale_) {
+            return;
+        }
+        scale_ = scale;
+        stale_ = true;
+        UpdateVertices();
+    }
+
+    void SpectrumScreen::SetVisible(bool visible) {
+        if (visible == visible_) {
+            return;
+        }
+        visible_ = visible;
+        dirty_ = true;
+        UpdateVertices();
+    }
+
+    void SpectrumScreen::UpdateVertices() {
+        const std::uint64_t version = series_ ? series_->GetVersion() : 0;
+        if (!visible_ || (version == drawn_version_ && !stale_)) {
+            return;
+        }
+        drawn_version_ = version;
+        stale_ = false;
+        dirty_ = true;
+
+        const int columns = static_cast<int>(amplitude_min_.size());
+        const float kEmpty = -1.f;
+        std::fill(amplitude_min_.begin(), amplitude_min_.end(), kEmpty);
+        std::fill(amplitude_max_.begin(), amplitude_max_.end(), kEmpty);
+        std::fill(phase_min_.begin(), phase_min_.end(), static_cast<float>(kPi));
+        std::fill(phase_max_.begin(), phase_max_.end(), static_cast<float>(-kPi));
+
+        // Amplitude pane on top, phase pane below, both half the height. Pixel y grows
+        // downwards, so bars rise from the amplitude baseline and +pi is above the phase axis.
+        const float pane = size_.y / 2.f;
+        const float amplitude_base = position_.y + pane;
+        const float phase_center = position_.y + 1.5f * pane;
+
+        vertices_.clear();
+        auto add_line = [&](sf::Vector2f from, sf::Vector2f to, sf::Color color) {
+            sf::Vertex a;
+            a.position = from;
+            a.color = color;
+            sf::Vertex b;
+            b.position = to;
+            b.color = color;
+            vertices_.push_back(a);
+            vertices_.push_back(b);
+        };
+        add_line({position_.x, amplitude_base}, {position_.x + size_.x, amplitude_base}, kSpectrumAxisColor);
+        add_line({position_.x, phase_center}, {position_.x + size_.x, phase_center}, kSpectrumAxisColor);
+
+        const std::vector<fourier_sim::HarmonicCoefficient<float>> empty;
+        const std::vector<fourier_sim::HarmonicCoefficient<float>>& coefficients = series_ ? series_->GetCoefficients() : empty;
+        const int max_index = series_ ? series_->GetMaxIndex() : -1;
+        if (coefficients.empty() || max_index < 0) {
+            return;
+        }
+
+        double peak = 0.0;
+        for (const fourier_sim::HarmonicCoefficient<float>& c : coefficients) {
+            peak = std::max(peak, (c.index == 0) ? std::abs(c.a / 2.0) : std::hypot(static_cast<double>(c.a), static_cast<double>(c.b)));
+        }
+        if (!(peak > 0.0)) {
+            peak = 1.0;
+        }
+
+        // Index to column, index + 1 on the log axis so the mean term has a place
+        const bool log_index = scale_ == SpectrumScale::kLogLog;
+        const double index_span = log_index ? std::log(max_index + 1.0) + 1e-12 : max_index + 1.0;
+        const double log_floor = std::log10(peak) - kLogDecades;
+
+        // Amplitude as a share of the pane, 0 at the floor and 1 at the peak
+        auto height = [&](double amplitude) {
+            if (scale_ == SpectrumScale::kLinear) {
+                return static_cast<float>(amplitude / peak);
+            }
+            return (amplitude > 0.0) ? static_cast<float>(std::clamp((std::log10(amplitude) - log_floor) / kLogDecades, 0.0, 1.0)) : 0.f;
+        };
+
+        for (const fourier_sim::HarmonicCoefficient<float>& c : coefficients) {
+            const double position = log_index ? std::log(c.index + 1.0) : static_cast<double>(c.index);
+            const int column = std::clamp(static_cast<int>(position / index_span * columns), 0, columns - 1);
+
+            // a cos(t) + b sin(t) = |c| cos(t - phase)
+            const double amplitude = (c.index == 0) ? std::abs(c.a / 2.0) : std::hypot(static_cast<double>(c.a), static_cast<double>(c.b));
+            const float h = height(amplitude);
+            amplitude_min_[column] = (amplitude_min_[column] < 0.f) ? h : std::min(amplitude_min_[column], h);
+            amplitude_max_[column] = std::max(amplitude_max_[column], h);
+
+            if (amplitude > kPhaseFloor * peak) {
+                const float phase = (c.index == 0) ? ((c.a < 0.f) ? static_cast<float>(kPi) : 0.f) 
+                                                   : static_cast<float>(std::atan2(static_cast<double>(c.b), static_cast<double>(c.a)));
+                phase_min_[column] = std::min(phase_min_[column], phase);
+                phase_max_[column] = std::max(phase_max_[column], phase);
+            }
+        }
+
+        // Bars are at least a pixel tall so single harmonics stay visible
+        for (int j = 0; j < columns; ++j) {
+            const float x = position_.x + j + 0.5f;
+            if (amplitude_max_[j] >= 0.f) {
+                const float low = amplitude_base - amplitude_min_[j] * (pane - 1.f);
+                const float high = amplitude_base - amplitude_max_[j] * (pane - 1.f);
+                add_line({x, amplitude_base}, {x, low}, kStemColor);
+                add_line({x, low}, {x, std::min(high, low - 1.f)}, kAmplitudeColor);
+            }
+            if (phase_max_[j] >= phase_min_[j]) {
+                const float scale = (pane / 2.f - 1.f) / static_cast<float>(kPi);
+                const float low = phase_center - phase_min_[j] * scale;
+                const float high = phase_center - phase_max_[j] * scale;
+                add_line({x, low}, {x, std::min(high, low - 1.f)}, kPhaseColor);
+            }
         }
     }
 
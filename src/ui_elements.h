@@ -2,7 +2,11 @@
 #define UI_ELEMENTS_H_
 
 #include <SFML/Graphics.hpp>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include "series.h"
+#include "static_layer.h"
 
 namespace ui {
 
@@ -14,13 +18,18 @@ class Slider{
 
         void HandleEvent(const sf::Event& event, const sf::RenderWindow& window);
 
-        void Draw(sf::RenderWindow& window) const;
+        void Draw(sf::RenderTarget& target) const;
 
         float GetValue() const;
         void ResetValue();
 
         void SetMaxValue(float max_value) { max_value_ = max_value;}
 
+        // Set when the handle moved since ClearDirty, GetBounds covers the whole travel
+        bool IsDirty() const { return dirty_; }
+        void ClearDirty() { dirty_ = false; }
+        sf::FloatRect GetBounds() const;
+
 
     private:
         sf::RectangleShape track_;
@@ -28,6 +37,7 @@ class Slider{
         float min_value_;
         float max_value_;
         bool is_dragging_ = false;
+        bool dirty_ = true;
 
 };
 
@@ -35,7 +45,13 @@ class Panel {
     public:
         Panel(sf::Vector2f position, sf::Vector2f size, sf::Color color = sf::Color(30, 30, 30));
 
-        void Draw(sf::RenderWindow& window) const; 
+        void Draw(sf::RenderTarget& target) const; 
+
+        // Adds the background to a layer drawn in one batch with the other panels
+        void Bake(StaticLayer& layer) const;
+
+        // Panels never change, they are repainted only under a dirty widget
+        sf::FloatRect GetBounds() const { return background_.getGlobalBounds(); }
 
     private:
         sf::RectangleShape background_;
@@ -47,7 +63,7 @@ class TextBox{
 
         void HandleEvent(const sf::Event& event, const sf::RenderWindow& window);
 
-        void Draw(sf::RenderWindow& window) const;
+        void Draw(sf::RenderTarget& target) const;
 
         std::string GetText() const;
         void SetText(const std::string& text);
@@ -56,31 +72,64 @@ class TextBox{
         bool IsReadyToDraw() const { return ready_to_draw_; }
         void ResetReadyToDraw() { ready_to_draw_ = false; }
 
+        // Set by typing, focus changes and SetText, so only the box is repainted
+        bool IsDirty() const { return dirty_; }
+        void ClearDirty() { dirty_ = false; }
+        sf::FloatRect GetBounds() const { return box_.getGlobalBounds(); }
+
     private:
         sf::RectangleShape box_;
         sf::Text display_text_;
         std::string content_;
         bool is_focused_ = false;
         bool ready_to_draw_ = false;
+        bool dirty_ = true;
 
         const sf::Color kColorFocused = sf::Color(60, 60, 60);
         const sf::Color kColorUnfocused = sf::Color(30, 30, 30);
 
 };
 
+// kLatest shows the harmonic at the index alone. kOverlay draws every harmonic of the
+// band over each other on one axis, kStacked gives each its own baseline from the top
+// down; both colour the band from red to magenta and scale it by its largest amplitude.
+// The band is the first kBand positions of the series' coefficient list.
+enum class HarmonicView { kLatest, kOverlay, kStacked };
+
 class HarmonicScreen {
     public:
-        HarmonicScreen(sf::Vector2f position, sf::Vector2f size, std::vector<std::function<float(float)>> harmonics, sf::Color color = sf::Color(30, 30, 30));
+        static constexpr int kBand = 256;
 
-        void Draw(sf::RenderWindow& window) const;
+        HarmonicScreen(sf::Vector2f position, sf::Vector2f size, sf::Color color = sf::Color(30, 30, 30));
 
+        void Draw(sf::RenderTarget& target) const;
+
+        // index is a position in the series' coefficient list
         void UpdateHarmonicIndex(int index);
 
-        void SetHarmonics(const std::vector<std::function<float(float)>>& new_harmonics);
+        // Shares the generator's immutable series, nothing is copied. The curve is only
+        // resampled when the series version or the index differs from the drawn one; an
+        // index outside the new series keeps the old one, clamped to the last coefficient.
+        void SetSeries(std::shared_ptr<const fourier_sim::Series<float>> series, int index);
+
+        void SetView(HarmonicView view);
+        HarmonicView GetView() const { return view_; }
+
+        // Set whenever the curve was resampled
+        bool IsDirty() const { return dirty_; }
+        void ClearDirty() { dirty_ = false; }
+        sf::FloatRect GetBounds() const { return background_.getGlobalBounds(); }
 
     private:
         void RecalculateVertices();
-        std::vector<sf::Vertex> CalculateFunctionVertices(std::function<float(float)> func);
+
+        // Fills func_vertices_ in place, its size is fixed by the screen width
+        void UpdateFunctionVertices();
+
+        // All curves of the band in one pass into band_vertices_, line segments so the
+        // whole band is a single draw call
+        void UpdateBandVertices();
+        void Refresh();
 
         sf::RectangleShape background_;
         int current_harmonic_index_ = 0;
@@ -96,7 +145,74 @@ class HarmonicScreen {
 
         sf::Vector2f position_;
         sf::Vector2f size_;
-        std::vector<std::function<float(float)>> harmonics_;
+        std::shared_ptr<const fourier_sim::Series<float>> series_;
+
+        // What func_vertices_ shows, version 0 is no series
+        std::uint64_t drawn_version_ = 0;
+        int drawn_index_ = -1;
+        bool curve_visible_ = false;
+        bool dirty_ = true;
+
+        HarmonicView view_ = HarmonicView::kLatest;
+        std::vector<sf::Vertex> band_vertices_;
+
+        // Series version band_vertices_ was built from, stale after a view change
+        std::uint64_t band_version_ = 0;
+        bool band_stale_ = true;
 };
+
+// Axes of the spectrum view: amplitude linear or over kLogDecades decades below the
+// peak, and in kLogLog also the harmonic index on a log axis
+enum class SpectrumScale { kLinear, kLogAmplitude, kLogLog };
+
+// |c_n| above and the phase of c_n below for every coefficient of a series, straight
+// from the coefficient table. Harmonics are binned per pixel column and each column
+// keeps its lowest and highest value, so a million harmonics are a few hundred line
+// segments: a dim stem up to the column minimum and a bright bar from minimum to
+// maximum. Position is the top left corner in the window's y-down pixel view.
+class SpectrumScreen {
+    public:
+        static constexpr int kLogDecades = 8;
+
+        SpectrumScreen(sf::Vector2f position, sf::Vector2f size, sf::Color color = sf::Color(20, 20, 20, 230));
+
+        void Draw(sf::RenderTarget& target) const;
+
+        // Shared like HarmonicScreen's, rebinned only for a new version while visible
+        void SetSeries(std::shared_ptr<const fourier_sim::Series<float>> series);
+
+        void SetScale(SpectrumScale scale);
+        SpectrumScale GetScale() const { return scale_; }
+
+        void SetVisible(bool visible);
+        bool IsVisible() const { return visible_; }
+
+        bool IsDirty() const { return dirty_; }
+        void ClearDirty() { dirty_ = false; }
+        sf::FloatRect GetBounds() const { return background_.getGlobalBounds(); }
+
+    private:
+        void UpdateVertices();
+
+        sf::RectangleShape background_;
+        sf::Vector2f position_;
+        sf::Vector2f size_;
+
+        std::shared_ptr<const fourier_sim::Series<float>> series_;
+        SpectrumScale scale_ = SpectrumScale::kLogAmplitude;
+        bool visible_ = false;
+
+        // Per column lowest and highest amplitude and phase, reused between updates
+        std::vector<float> amplitude_min_;
+        std::vector<float> amplitude_max_;
+        std::vector<float> phase_min_;
+        std::vector<float> phase_max_;
+        std::vector<sf::Vertex> vertices_;
+
+        std::uint64_t drawn_version_ = 0;
+        bool stale_ = true;
+        bool dirty_ = true;
+};
+
 } // namespace ui
 #endif  // UI_ELEMENTS_H_
\ No newline at end of file
@@ -0,0 +1,508 @@
+#include "waveform.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+
+namespace fourier_sim {
+
+namespace {
+    const long double kPiLong = 3.141592653589793238462643383279502884L;
+    const long double kTwoPiLong = 2.0L * kPiLong;
+
+    // x^k beyond this is left to the sampled path, the moment recurrence loses digits
+    const int kMaxDegree = 8;
+
+    // Below |z w| = 1 the moments come from their Taylor series, above it from the recurrence
+    const long double kSeriesLimit = 1.0L;
+    const int kMaxSeriesTerms = 64;
+
+    long double ShapeValue(const WaveformTerm& term, long double u) {
+        switch (term.kind) {
+            case WaveformKind::kSquare: return SquareWave(u);
+            case WaveformKind::kSawtooth: return SawtoothWave(u);
+            case WaveformKind::kTriangle: return TriangleWave(u);
+            case WaveformKind::kPulse: return PulseWave(u, static_cast<long double>(term.duty));
+            case WaveformKind::kExponential: return std::exp(u);
+            case WaveformKind::kPolynomial: return 0.0L;
+        }
+        return 0.0L;
+    }
+
+    // Phases in [0, 2 pi) where a periodic shape jumps or turns
+    std::vector<long double> CornerPhases(const WaveformTerm& term) {
+        switch (term.kind) {
+            case WaveformKind::kSquare: return {0.0L, kPiLong};
+            case WaveformKind::kSawtooth: return {0.0L};
+            case WaveformKind::kTriangle: return {kPiLong / 2, 3 * kPiLong / 2};
+            case WaveformKind::kPulse: return {0.0L, kTwoPiLong * std::clamp(static_cast<long double>(term.duty), 0.0L, 1.0L)};
+            default: return {};
+        }
+    }
+
+    // f(x) = sum_k coeffs[k] (x - lo)^k e^{rate (x - lo)} on [lo, hi]
+    struct Piece {
+        long double lo, hi;
+        long double rate;
+        std::vector<long double> coeffs;
+    };
+
+    void AppendPieces(const WaveformTerm& term, long double range_start, long double range_end, std::vector<Piece>& pieces) {
+        if (term.kind == WaveformKind::kPolynomial) {
+            // Re-center the powers of x on range_start with the binomial expansion
+            const size_t count = term.powers.size();
+            std::vector<long double> coeffs(count, 0.0L);
+            for (size_t k = 0; k < count; ++k) {
+                long double binomial = 1.0L;
+                for (size_t j = 0; j <= k; ++j) {
+                    coeffs[j] += term.powers[k] * binomial * std::pow(range_start, static_cast<long double>(k - j));
+                    binomial = binomial * (k - j) / (j + 1);
+                }
+            }
+            pieces.push_back({range_start, range_end, 0.0L, coeffs});
+            return;
+        }
+
+        const long double scale = term.scale;
+        const long double slope = term.slope;
+        const long double offset = term.offset;
+
+        if (term.kind == WaveformKind::kExponential) {
+            pieces.push_back({range_start, range_end, slope, {scale * std::exp(slope * range_start + offset)}});
+            return;
+        }
+
+        if (slope == 0.0L) {
+            pieces.push_back({range_start, range_end, 0.0L, {scale * ShapeValue(term, offset)}});
+            return;
+        }
+
+        const long double u_start = slope * range_start + offset;
+        const long double u_end = slope * range_end + offset;
+        const long double u_low = std::min(u_start, u_end);
+        const long double u_high = std::max(u_start, u_end);
+
+        std::vector<long double> breaks = {range_start, range_end};
+        for (long double corner : CornerPhases(term)) {
+            long double first = std::ceil((u_low - corner) / kTwoPiLong);
+            long double last = std::floor((u_high - corner) / kTwoPiLong);
+            for (long double k = first; k <= last; k += 1.0L) {
+                long double x = (corner + k * kTwoPiLong - offset) / slope;
+                if (x > range_start && x < range_end) {
+                    breaks.push_back(x);
+                }
+            }
+        }
+        std::sort(breaks.begin(), breaks.end());
+
+        // Every shape is linear between corners, two interior values pin the line down
+        for (size_t k = 0; k + 1 < breaks.size(); ++k) {
+            const long double lo = breaks[k];
+            const long double hi = breaks[k + 1];
+            if (hi <= lo) {
+                continue;
+            }
+            const long double width = hi - lo;
+            const long double f1 = scale * ShapeValue(term, slope * (lo + width / 3) + offset);
+            const long double f2 = scale * ShapeValue(term, slope * (lo + 2 * width / 3) + offset);
+            const long double gradient = (f2 - f1) * 3 / width;
+            pieces.push_back({lo, hi, 0.0L, {f1 - gradient * width / 3, gradient}});
+        }
+    }
+
+    // J_k = int_0^w u^k e^{z u} du for k < count
+    std::vector<std::complex<long double>> Moments(std::complex<long double> z, long double w, size_t count) {
+        std::vector<std::complex<long double>> moments(count);
+        if (count == 0) {
+            return moments;
+        }
+
+        if (std::abs(z) * w < kSeriesLimit) {
+            for (size_t k = 0; k < count; ++k) {
+                // sum_j (z w)^j / j! * w^{k+1} / (k + j + 1)
+                std::complex<long double> power(std::pow(w, static_cast<long double>(k + 1)), 0.0L);
+                std::complex<long double> sum = 0.0L;
+                for (int j = 0; j < kMaxSeriesTerms; ++j) {
+                    std::complex<long double> term = power / static_cast<long double>(k + j + 1);
+                    sum += term;
+                    if (std::abs(term) <= 1e-21L * std::abs(sum)) {
+                        break;
+                    }
+                    power *= z * w / static_cast<long double>(j + 1);
+                }
+                moments[k] = sum;
+            }
+            return moments;
+        }
+
+        // J_0 = (e^{z w} - 1) / z, J_k = (w^k e^{z w} - k J_{k-1}) / z
+        const std::complex<long double> end = std::exp(z * w);
+        moments[0] = (end - 1.0L) / z;
+        long double w_power = 1.0L;
+        for (size_t k = 1; k < count; ++k) {
+            w_power *= w;
+            moments[k] = (w_power * end - static_cast<long double>(k) * moments[k - 1]) / z;
+        }
+        return moments;
+    }
+
+    // Expression value while parsing: polynomial part plus transcendental terms
+    struct Expression {
+        std::vector<long double> poly;
+        std::vector<WaveformTerm> atoms;
+    };
+
+    void Trim(std::vector<long double>& poly) {
+        while (!poly.empty() && poly.back() == 0.0L) {
+            poly.pop_back();
+        }
+    }
+
+    bool IsConstant(const Expression& e) {
+        return e.atoms.empty() && e.poly.size() <= 1;
+    }
+
+    long double ConstantValue(const Expression& e) {
+        return e.poly.empty() ? 0.0L : e.poly[0];
+    }
+
+    Expression Constant(long double value) {
+        Expression e;
+        e.poly = {value};
+        Trim(e.poly);
+        return e;
+    }
+
+    void Scale(Expression& e, long double factor) {
+        for (long double& c : e.poly) {
+            c *= factor;
+        }
+        for (WaveformTerm& atom : e.atoms) {
+            atom.scale *= factor;
+        }
+        Trim(e.poly);
+    }
+
+    class FormulaReader {
+
+        public:
+            explicit FormulaReader(const std::string& text) : text_(text) {}
+
+            bool Read(Expression& result) {
+                result = ParseSum();
+                SkipSpaces();
+                return ok_ && pos_ == text_.size();
+            }
+
+        private:
+            void SkipSpaces() {
+                while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+                    ++pos_;
+                }
+            }
+
+            bool Accept(char c) {
+                SkipSpaces();
+                if (pos_ < text_.size() && text_[pos_] == c) {
+                    ++pos_;
+                    return true;
+                }
+                return false;
+            }
+
+            Expression Fail() {
+                ok_ = false;
+                return Expression();
+            }
+
+            Expression ParseSum() {
+                Expression result = ParseProduct();
+                while (ok_) {
+                    long double sign;
+                    if (Accept('+')) {
+                        sign = 1.0L;
+                    } else if (Accept('-')) {
+                        sign = -1.0L;
+                    } else {
+                        break;
+                    }
+
+                    Expression rhs = ParseProduct();
+                    Scale(rhs, sign);
+                    if (rhs.poly.size() > result.poly.size()) {
+                        result.poly.resize(rhs.poly.size(), 0.0L);
+                    }
+                    for (size_t k = 0; k < rhs.poly.size(); ++k) {
+                        result.poly[k] += rhs.poly[k];
+                    }
+                    Trim(result.poly);
+                    result.atoms.insert(result.atoms.end(), rhs.atoms.begin(), rhs.atoms.end());
+                }
+                return result;
+            }
+
+            Expression ParseProduct() {
+                Expression result = ParseUnary();
+                while (ok_) {
+                    if (Accept('*')) {
+                        result = Multiply(result, ParseUnary());
+                    } else if (Accept('/')) {
+                        Expression rhs = ParseUnary();
+                        if (!IsConstant(rhs) || ConstantValue(rhs) == 0.0L) {
+                            return Fail();
+                        }
+                        Scale(result, 1.0L / ConstantValue(rhs));
+                    } else {
+                        break;
+                    }
+                }
+                return result;
+            }
+
+            Expression ParseUnary() {
+                if (Accept('-')) {
+                    Expression e = ParseUnary();
+                    Scale(e, -1.0L);
+                    return e;
+                }
+                if (Accept('+')) {
+                    return ParseUnary();
+                }
+                return ParsePower();
+            }
+
+            Expression ParsePower() {
+                Expression base = ParsePrimary();
+                if (!ok_ || !Accept('^')) {
+                    return base;
+                }
+
+                Expression exponent = ParseUnary();
+                if (!ok_ || !IsConstant(exponent)) {
+                    return Fail();
+                }
+
+                const long double power = ConstantValue(exponent);
+                if (IsConstant(base)) {
+                    return Constant(std::pow(ConstantValue(base), power));
+                }
+                if (!base.atoms.empty() || power < 0.0L || power != std::floor(power) ||
+                    (base.poly.size() - 1) * power > kMaxDegree) {
+                    return Fail();
+                }
+
+                Expression result = Constant(1.0L);
+                for (int k = 0; k < static_cast<int>(power); ++k) {
+                    result = Multiply(result, base);
+                }
+                return result;
+            }
+
+            Expression Multiply(const Expression& lhs, const Expression& rhs) {
+                if (!ok_) {
+                    return Expression();
+                }
+                if (IsConstant(lhs)) {
+                    Expression result = rhs;
+                    Scale(result, ConstantValue(lhs));
+                    return result;
+                }
+                if (IsConstant(rhs)) {
+                    Expression result = lhs;
+                    Scale(result, ConstantValue(rhs));
+                    return result;
+                }
+                if (!lhs.atoms.empty() || !rhs.atoms.empty() || lhs.poly.size() + rhs.poly.size() - 2 > kMaxDegree) {
+                    return Fail();
+                }
+
+                Expression result;
+                result.poly.assign(lhs.poly.size() + rhs.poly.size() - 1, 0.0L);
+                for (size_t i = 0; i < lhs.poly.size(); ++i) {
+                    for (size_t j = 0; j < rhs.poly.size(); ++j) {
+                        result.poly[i + j] += lhs.poly[i] * rhs.poly[j];
+                    }
+                }
+                Trim(result.poly);
+                return result;
+            }
+
+            Expression ParsePrimary() {
+                SkipSpaces();
+                if (pos_ >= text_.size()) {
+                    return Fail();
+                }
+
+                if (Accept('(')) {
+                    Expression inner = ParseSum();
+                    return Accept(')') ? inner : Fail();
+                }
+
+                const char c = text_[pos_];
+                if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                    char* end = nullptr;
+                    long double value = std::strtold(text_.c_str() + pos_, &end);
+                    if (end == text_.c_str() + pos_) {
+                        return Fail();
+                    }
+                    pos_ = end - text_.c_str();
+                    return Constant(value);
+                }
+
+                if (!std::isalpha(static_cast<unsigned char>(c))) {
+                    return Fail();
+                }
+
+                size_t start = pos_;
+                while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+                    ++pos_;
+                }
+                const std::string name = text_.substr(start, pos_ - start);
+
+                if (name == "x") {
+                    Expression e;
+                    e.poly = {0.0L, 1.0L};
+                    return e;
+                }
+                if (name == "pi") {
+                    return Constant(kPiLong);
+                }
+
+                WaveformTerm term = {WaveformKind::kSquare, 1.0, 1.0, 0.0, 0.0, {}};
+                if (name == "square") {
+                    term.kind = WaveformKind::kSquare;
+                } else if (name == "sawtooth") {
+                    term.kind = WaveformKind::kSawtooth;
+                } else if (name == "triangle") {
+                    term.kind = WaveformKind::kTriangle;
+                } else if (name == "pulse") {
+                    term.kind = WaveformKind::kPulse;
+                } else if (name == "exp") {
+                    term.kind = WaveformKind::kExponential;
+                } else {
+                    return Fail();
+                }
+
+                // The argument has to be affine in x, the pulse duty a constant
+                if (!Accept('(')) {
+                    return Fail();
+                }
+                Expression argument = ParseSum();
+                if (!ok_ || !argument.atoms.empty() || argument.poly.size() > 2) {
+                    return Fail();
+                }
+                term.offset = static_cast<double>(argument.poly.size() > 0 ? argument.poly[0] : 0.0L);
+                term.slope = static_cast<double>(argument.poly.size() > 1 ? argument.poly[1] : 0.0L);
+
+                if (term.kind == WaveformKind::kPulse) {
+                    if (!Accept(',')) {
+                        return Fail();
+                    }
+                    Expression duty = ParseSum();
+                    if (!ok_ || !IsConstant(duty)) {
+                        return Fail();
+                    }
+                    term.duty = static_cast<double>(ConstantValue(duty));
+                }
+                if (!Accept(')')) {
+                    return Fail();
+                }
+
+                Expression e;
+                e.atoms.push_back(term);
+                return e;
+            }
+
+            const std::string& text_;
+            size_t pos_ = 0;
+            bool ok_ = true;
+
+    };
+} // namespace
+
+const char* WaveformName(WaveformKind kind) {
+    switch (kind) {
+        case WaveformKind::kSquare: return "square";
+        case WaveformKind::kSawtooth: return "sawtooth";
+        case WaveformKind::kTriangle: return "triangle";
+        case WaveformKind::kPulse: return "pulse";
+        case WaveformKind::kExponential: return "exp";
+        case WaveformKind::kPolynomial: return "polynomial";
+    }
+    return "unknown";
+}
+
+double Waveform::Evaluate(double x) const {
+    long double sum = 0.0L;
+    for (const WaveformTerm& term : terms_) {
+        if (term.kind == WaveformKind::kPolynomial) {
+            long double power = 0.0L;
+            for (size_t k = term.powers.size(); k-- > 0;) {
+                power = power * x + term.powers[k];
+            }
+            sum += power;
+        } else {
+            sum += term.scale * ShapeValue(term, static_cast<long double>(term.slope) * x + term.offset);
+        }
+    }
+    return static_cast<double>(sum);
+}
+
+template <typename T>
+std::vector<HarmonicCoefficient<T>> Waveform::Coefficients(T range_start, T range_end, const std::vector<int>& indices) const {
+    const long double start = range_start;
+    const long double end = range_end;
+    const long double L = (end - start) / 2;
+
+    std::vector<Piece> pieces;
+    for (const WaveformTerm& term : terms_) {
+        AppendPieces(term, start, end, pieces);
+    }
+
+    std::vector<HarmonicCoefficient<T>> coefficients;
+    coefficients.reserve(indices.size());
+    for (int n : indices) {
+        const long double w = n * kPiLong / L;
+
+        // int f(x) e^{i w x} dx, piece by piece in its local coordinate
+        std::complex<long double> sum = 0.0L;
+        for (const Piece& piece : pieces) {
+            std::vector<std::complex<long double>> moments = Moments({piece.rate, w}, piece.hi - piece.lo, piece.coeffs.size());
+            std::complex<long double> local = 0.0L;
+            for (size_t k = 0; k < piece.coeffs.size(); ++k) {
+                local += piece.coeffs[k] * moments[k];
+            }
+            sum += std::polar(1.0L, w * piece.lo) * local;
+        }
+
+        coefficients.push_back({n, static_cast<T>(sum.real() / L), static_cast<T>(sum.imag() / L)});
+    }
+
+    return coefficients;
+}
+
+bool ParseWaveform(const std::string& formula, Waveform& waveform) {
+    waveform = Waveform();
+
+    Expression expression;
+    FormulaReader reader(formula);
+    if (!reader.Read(expression)) {
+        return false;
+    }
+
+    for (const WaveformTerm& atom : expression.atoms) {
+        waveform.Add(atom);
+    }
+    if (!expression.poly.empty() || expression.atoms.empty()) {
+        std::vector<double> powers(expression.poly.begin(), expression.poly.end());
+        waveform.Add({WaveformKind::kPolynomial, 1.0, 1.0, 0.0, 0.0, powers});
+    }
+    return true;
+}
+
+template std::vector<HarmonicCoefficient<float>> Waveform::Coefficients<float>(float, float, const std::vector<int>&) const;
+template std::vector<HarmonicCoefficient<double>> Waveform::Coefficients<double>(double, double, const std::vector<int>&) const;
+template std::vector<HarmonicCoefficient<long double>> Waveform::Coefficients<long double>(long double, long double, const std::vector<int>&) const;
+
+} // namespace fourier_sim
@@ -0,0 +1,146 @@
+#ifndef WAVEFORM_H_
+#define WAVEFORM_H_
+
+#include <limits>
+#include <string>
+#include <vector>
+#include "coefficient_engine.h"
+
+namespace fourier_sim {
+
+// Built-in periodic shapes as constexpr functors, period 2 pi and phase matched
+// to sin(x). Passing them (or lambdas around them) to the templated Generator and
+// eq_sim entry points inlines the whole sampling loop.
+constexpr long double kWavePeriod = 6.283185307179586476925286766559005768L;
+
+// x reduced to [0, 2 pi) without the non-constexpr std::fmod or std::floor. The turn
+// count is rounded by adding and subtracting 2^(digits - 1), which is exact for every
+// finite count (past that magnitude it is whole already), so there is no integer cast
+// to overflow. Conditions become selects and arithmetic on 0/1 factors, so sampling
+// loops over the shapes below vectorize. Large x wrap to within the rounding of x
+// itself; inf and NaN give NaN. Needs strict IEEE arithmetic, like NeumaierSum.
+template <typename T>
+constexpr T WrapPeriod(T x) {
+    const T period = static_cast<T>(kWavePeriod);
+    const T turns = x * static_cast<T>(1.0L / kWavePeriod);
+    const T magic = static_cast<T>(1ULL << (std::numeric_limits<T>::digits - 1));
+
+    // Round to nearest, then down. False for NaN, which then stays NaN
+    const T shift = (turns < T(0)) ? -magic : magic;
+    T whole = (turns < magic && turns > -magic) ? (turns + shift) - shift : turns;
+    whole -= static_cast<T>(whole > turns);
+
+    T u = x - whole * period;
+    u += period * static_cast<T>(u < T(0));
+    u -= period * static_cast<T>(u >= period);
+
+    // Only reached when whole * period rounds by more than a period, x is then far
+    // beyond any meaningful phase
+    return (u < T(0) || u >= period) ? T(0) : u;
+}
+
+// +1 on [0, pi), -1 on [pi, 2 pi)
+struct SquareShape {
+    template <typename T>
+    constexpr T operator()(T x) const {
+        return T(1) - T(2) * static_cast<T>(WrapPeriod(x) >= static_cast<T>(kWavePeriod / 2));
+    }
+};
+
+// Rises from -1 to 1 over [0, 2 pi)
+struct SawtoothShape {
+    template <typename T>
+    constexpr T operator()(T x) const {
+        return WrapPeriod(x) * static_cast<T>(2.0L / kWavePeriod) - T(1);
+    }
+};
+
+// 0 at 0, 1 at pi / 2, -1 at 3 pi / 2
+struct TriangleShape {
+    template <typename T>
+    constexpr T operator()(T x) const {
+        // Quarter periods shifted by one, so the peak sits at w = 2
+        T w = WrapPeriod(x) * static_cast<T>(4.0L / kWavePeriod) + T(1);
+        w -= T(4) * static_cast<T>(w >= T(4));
+        const T d = w - T(2);
+        return T(1) - d * (T(1) - T(2) * static_cast<T>(d < T(0)));
+    }
+};
+
+// 1 on the first duty fraction of each period, 0 elsewhere
+struct PulseShape {
+    double duty;
+
+    template <typename T>
+    constexpr T operator()(T x) const {
+        return static_cast<T>(WrapPeriod(x) < static_cast<T>(duty) * static_cast<T>(kWavePeriod));
+    }
+};
+
+// Free functions with the same shapes, for ExprTk under the same names, lower case
+template <typename T>
+constexpr T SquareWave(T x) { return SquareShape()(x); }
+
+template <typename T>
+constexpr T SawtoothWave(T x) { return SawtoothShape()(x); }
+
+template <typename T>
+constexpr T TriangleWave(T x) { return TriangleShape()(x); }
+
+template <typename T>
+constexpr T PulseWave(T x, T duty) {
+    return static_cast<T>(WrapPeriod(x) < duty * static_cast<T>(kWavePeriod));
+}
+
+enum class WaveformKind {
+    kSquare,
+    kSawtooth,
+    kTriangle,
+    kPulse,
+    kExponential,
+    kPolynomial
+};
+
+const char* WaveformName(WaveformKind kind);
+
+// scale * shape(slope * x + offset). Polynomials ignore slope and offset and
+// use powers[k] as the coefficient of x^k, scale included.
+struct WaveformTerm {
+    WaveformKind kind;
+    double scale;
+    double slope;
+    double offset;
+    double duty;
+    std::vector<double> powers;
+};
+
+// Sum of terms that are piecewise polynomial or exponential, so every Fourier
+// coefficient over any range has a closed form and no sampling is needed
+class Waveform {
+
+    public:
+        void Add(const WaveformTerm& term) { terms_.push_back(term); }
+        const std::vector<WaveformTerm>& GetTerms() const { return terms_; }
+        bool IsEmpty() const { return terms_.empty(); }
+
+        double Evaluate(double x) const;
+
+        // Exact a_n, b_n over [range_start, range_end], evaluated in long double.
+        // O(pieces) per index, where a periodic term has two or four pieces per period.
+        // Instantiated for float, double and long double in waveform.cpp.
+        template <typename T>
+        std::vector<HarmonicCoefficient<T>> Coefficients(T range_start, T range_end, const std::vector<int>& indices) const;
+
+    private:
+        std::vector<WaveformTerm> terms_;
+
+};
+
+// Recognizes sums of constant multiples of square, sawtooth, triangle, pulse and exp
+// over an affine argument, plus any polynomial in x. Anything else returns false and
+// leaves waveform empty, so the caller falls back to sampling.
+bool ParseWaveform(const std::string& formula, Waveform& waveform);
+
+} // namespace fourier_sim
+
+#endif  // WAVEFORM_H_